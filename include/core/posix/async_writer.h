@@ -0,0 +1,137 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Thomas Voß <thomas.voss@canonical.com>
+ */
+
+#ifndef CORE_POSIX_ASYNC_WRITER_H_
+#define CORE_POSIX_ASYNC_WRITER_H_
+
+#include <core/posix/visibility.h>
+
+#include <core/signal.h>
+
+#include <cstddef>
+
+#include <future>
+#include <memory>
+#include <string>
+
+namespace core
+{
+namespace posix
+{
+class ChildProcess;
+class IoEngine;
+
+/**
+ * @brief The AsyncWriter class feeds the stdin of a child process without ever blocking the caller.
+ *
+ * Buffers handed to write() are queued and written by an IoEngine, coalescing
+ * as many queued buffers as possible into a single gathering write. Once the
+ * amount of queued data exceeds the high watermark, the writer reports
+ * backpressure until the queue has been drained below the low watermark.
+ *
+ * The writer takes over the stdin pipe of the child: the engine adjusts the
+ * flags of the pipe to its needs, so do not use ChildProcess::cin() alongside it.
+ *
+ * All functions are thread-safe.
+ */
+class CORE_POSIX_DLL_PUBLIC AsyncWriter
+{
+public:
+    /**
+     * @brief The Configuration struct bundles the watermarks of a writer.
+     */
+    struct Configuration
+    {
+        std::size_t high_watermark = 1024 * 1024; ///< Backpressure is reported once this many bytes are queued.
+        std::size_t low_watermark = 64 * 1024; ///< Backpressure is released once the queue drops below this many bytes.
+    };
+
+    /**
+     * @brief Creates a writer for the stdin of child with default watermarks, driven by the given engine.
+     * @throw std::logic_error if the stdin of child has not been redirected.
+     * @param [in] engine The engine carrying out the writes.
+     * @param [in] child The child process to write to.
+     */
+    static std::shared_ptr<AsyncWriter> create_for_stdin(
+            const std::shared_ptr<IoEngine>& engine,
+            const ChildProcess& child);
+
+    /**
+     * @brief Creates a writer for the stdin of child, driven by the given engine.
+     * @throw std::logic_error if the stdin of child has not been redirected.
+     * @param [in] engine The engine carrying out the writes.
+     * @param [in] child The child process to write to.
+     * @param [in] configuration Watermarks for reporting backpressure.
+     */
+    static std::shared_ptr<AsyncWriter> create_for_stdin(
+            const std::shared_ptr<IoEngine>& engine,
+            const ChildProcess& child,
+            const Configuration& configuration);
+
+    AsyncWriter(const AsyncWriter&) = delete;
+    virtual ~AsyncWriter() = default;
+
+    AsyncWriter& operator=(const AsyncWriter&) = delete;
+    bool operator==(const AsyncWriter&) const = delete;
+
+    /**
+     * @brief Queues a buffer for writing. Never blocks.
+     * @throw std::logic_error if stdin has been closed.
+     * @throw std::system_error if a previous write failed.
+     * @param [in] buffer The data to write.
+     * @return false if the writer reports backpressure, true otherwise.
+     */
+    virtual bool write(std::string buffer) = 0;
+
+    /**
+     * @brief Returns the number of bytes queued but not yet written.
+     */
+    virtual std::size_t pending() const = 0;
+
+    /**
+     * @brief Returns true if the writer reports backpressure.
+     */
+    virtual bool is_backpressured() const = 0;
+
+    /**
+     * @brief Returns a future that becomes ready once all data queued so far has been written.
+     *
+     * The future holds a std::system_error if writing failed.
+     */
+    virtual std::future<void> flushed() = 0;
+
+    /**
+     * @brief Closes the stdin of the child once all queued data has been written, signalling end-of-file.
+     */
+    virtual void close_stdin() = 0;
+
+    /**
+     * @brief Emitted with true when backpressure is reported, and with false once it is released.
+     *
+     * The signal is emitted on the thread that caused the change, i.e., either
+     * a thread calling write() or the thread running the engine.
+     */
+    virtual const core::Signal<bool>& backpressure_changed() const = 0;
+
+protected:
+    AsyncWriter() = default;
+};
+}
+}
+
+#endif // CORE_POSIX_ASYNC_WRITER_H_
@@ -0,0 +1,179 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Thomas Voß <thomas.voss@canonical.com>
+ */
+
+#ifndef CORE_POSIX_BOUNDED_CAPTURE_H_
+#define CORE_POSIX_BOUNDED_CAPTURE_H_
+
+#include <core/posix/visibility.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <memory>
+#include <string>
+#include <system_error>
+
+namespace core
+{
+namespace posix
+{
+/**
+ * @brief The BoundedCapture class retains the output of a child process in constant memory.
+ *
+ * A capture keeps the first head_size bytes it sees and the last tail_size
+ * bytes in a fixed-size ring. Both buffers are allocated once, on construction,
+ * and data read from a file descriptor is placed directly into them. Whatever
+ * does not fit is handled according to the configured policy.
+ *
+ * Typical use with a child process's redirected stdout:
+ * @code
+ * core::posix::BoundedCapture capture{{4096, 4096, core::posix::BoundedCapture::Policy::discard}};
+ * capture.read_all_from_or_throw(child.native_handle(core::posix::StandardStream::stdout));
+ * @endcode
+ *
+ * Instances are not thread-safe.
+ */
+class CORE_POSIX_DLL_PUBLIC BoundedCapture
+{
+public:
+    /**
+     * @brief Policy enumerates the ways of handling output that does not fit into the capture.
+     */
+    enum class Policy
+    {
+        discard, ///< Keep reading, overwrite the oldest tail bytes and account for them as dropped.
+        backpressure ///< Stop reading once head and tail are full, leaving further output in the pipe.
+    };
+
+    /**
+     * @brief The Configuration struct bundles the sizes and policy of a capture.
+     */
+    struct Configuration
+    {
+        std::size_t head_size; ///< Number of leading bytes to retain.
+        std::size_t tail_size; ///< Number of trailing bytes to retain.
+        Policy policy; ///< How to handle output that does not fit.
+    };
+
+    /**
+     * @brief Creates a new capture, allocating head and tail buffers up front.
+     * @param [in] configuration Sizes and policy of the capture.
+     */
+    explicit BoundedCapture(const Configuration& configuration);
+
+    BoundedCapture(const BoundedCapture&) = delete;
+    ~BoundedCapture();
+
+    BoundedCapture& operator=(const BoundedCapture&) = delete;
+    bool operator==(const BoundedCapture&) const = delete;
+
+    /**
+     * @brief Accesses the configuration this capture has been created with.
+     */
+    const Configuration& configuration() const;
+
+    /**
+     * @brief Feeds the given bytes into the capture.
+     * @param [in] data Pointer to the bytes.
+     * @param [in] size Number of bytes pointed to by data.
+     * @return The number of bytes consumed, which is less than size only under Policy::backpressure.
+     */
+    std::size_t write(const char* data, std::size_t size);
+
+    /**
+     * @brief Issues a single read on fd, placing the data directly into the capture.
+     *
+     * Returns 0 without an error on end-of-file or, under Policy::backpressure,
+     * if the capture is full. A non-blocking fd without pending data
+     * results in e being set to std::errc::resource_unavailable_try_again.
+     *
+     * @param [in] fd The file descriptor to read from.
+     * @param [out] e Set to contain an error if an issue arises.
+     * @return The number of bytes read from fd.
+     */
+    std::size_t read_some_from(int fd, std::error_code& e) noexcept(true);
+
+    /**
+     * @brief Issues a single read on fd, placing the data directly into the capture.
+     * @throw std::system_error in case of errors.
+     * @param [in] fd The file descriptor to read from.
+     * @return The number of bytes read from fd.
+     */
+    std::size_t read_some_from_or_throw(int fd);
+
+    /**
+     * @brief Reads from fd until end-of-file, until an error occurs or, under Policy::backpressure, until full.
+     * @param [in] fd The file descriptor to read from.
+     * @param [out] e Set to contain an error if an issue arises.
+     * @return The number of bytes read from fd.
+     */
+    std::uint64_t read_all_from(int fd, std::error_code& e) noexcept(true);
+
+    /**
+     * @brief Reads from fd until end-of-file or, under Policy::backpressure, until full.
+     * @throw std::system_error in case of errors.
+     * @param [in] fd The file descriptor to read from.
+     * @return The number of bytes read from fd.
+     */
+    std::uint64_t read_all_from_or_throw(int fd);
+
+    /**
+     * @brief Checks whether no more data is accepted, which only ever happens under Policy::backpressure.
+     */
+    bool is_full() const;
+
+    /**
+     * @brief Returns a copy of the retained leading bytes.
+     */
+    std::string head() const;
+
+    /**
+     * @brief Returns a copy of the retained trailing bytes, in order.
+     */
+    std::string tail() const;
+
+    /**
+     * @brief Returns the number of bytes consumed, including dropped ones.
+     */
+    std::uint64_t total() const;
+
+    /**
+     * @brief Returns the number of bytes that have been consumed but are neither in head() nor in tail().
+     */
+    std::uint64_t dropped() const;
+
+    /**
+     * @brief Checks whether dropped() > 0.
+     */
+    bool is_truncated() const;
+
+    /**
+     * @brief Empties head and tail and resets all counters, releasing backpressure.
+     *
+     * The underlying buffers are retained and reused.
+     */
+    void reset();
+
+private:
+    struct CORE_POSIX_DLL_LOCAL Private;
+    std::unique_ptr<Private> d;
+};
+}
+}
+
+#endif // CORE_POSIX_BOUNDED_CAPTURE_H_
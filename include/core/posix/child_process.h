@@ -22,11 +22,15 @@
 #include <core/posix/process.h>
 #include <core/posix/standard_stream.h>
 #include <core/posix/visibility.h>
+#include <core/posix/wait.h>
 
 #include <core/signal.h>
 
+#include <chrono>
 #include <iosfwd>
 #include <functional>
+#include <future>
+#include <vector>
 
 namespace core
 {
@@ -47,15 +51,66 @@ public:
      * @brief The DeathObserver class observes child process' states and emits a signal when a monitored child has died.
      *
      * Please note that the name of this class is morbid for a reason: Listening
-     * for SIGCHLD is not enough to catch all dying children. Whenever a SIGCHLD is
-     * received, we have to wait for all the children of this process and reap all
-     * monitored ones. We are thus changing state and potentially race with other
-     * wait operations on children.
+     * for SIGCHLD is not enough to catch all dying children, as signals coalesce.
+     * The observer holds a pidfd for every monitored child and, whenever a SIGCHLD
+     * is received, reaps exactly those monitored children whose pidfd reports
+     * termination. The cost of handling a SIGCHLD thus scales with the number of
+     * exits, not with the number of monitored children, and children that have
+     * moved to another process group are reaped, too. On kernels without pidfd
+     * support, monitored children are checked one by one.
+     *
+     * Monitored children are reaped by the observer, so other wait operations
+     * on them race with it.
+     *
+     * Any number of observers can coexist, each of them monitoring a disjoint
+     * set of children. A single, process-wide reaper watches the pidfds of all
+     * monitored children and hands every exit to the observer monitoring the
+     * child, such that observers do not contend with each other.
      *
      */
     class DeathObserver
     {
     public:
+        /**
+         * @brief The Exit struct describes how an observed child terminated.
+         */
+        struct Exit
+        {
+            /** The pid the child had. */
+            pid_t pid;
+            /**
+             * How the child terminated. Status::undefined if the child
+             * has been reaped by somebody else.
+             */
+            wait::Result result;
+            /** The resources consumed by the child and its reaped descendants. */
+            wait::ResourceUsage usage;
+            /** The point in time the child has been reaped at. */
+            std::chrono::system_clock::time_point reaped_at;
+        };
+
+        /**
+         * @brief OrphanPolicy enumerates how an observer treats descendants that have been orphaned.
+         *
+         * A policy other than ignore marks this process as a subreaper, such
+         * that the descendants of dying children are re-parented to us
+         * instead of to init. Every child of this process that is not referred
+         * to by a ChildProcess instance is considered an orphan. Hence, do not
+         * mix these policies with children forked by other means, e.g., by
+         * ::system(3).
+         */
+        enum class OrphanPolicy
+        {
+            ignore, ///< Orphans are neither reaped nor reported, the default.
+            reap, ///< Orphans are reaped once they terminate, and reported via orphan_died.
+            kill_and_reap ///< Orphans are killed right away, then reaped and reported via orphan_died.
+        };
+
+        /**
+         * @brief The number of exits kept by an observer, unless adjusted by set_exit_history_size.
+         */
+        static constexpr std::size_t default_exit_history_size = 64;
+
         /**
          * @brief Creates the unique instance of class DeathObserver.
          * @throw std::logic_error if the given SignalTrap instance does not trap Signal::sig_chld.
@@ -64,6 +119,19 @@ public:
         static std::unique_ptr<DeathObserver> create_once_with_signal_trap(
                 std::shared_ptr<SignalTrap> trap);
 
+        /**
+         * @brief Creates an additional instance of class DeathObserver.
+         *
+         * Unlike create_once_with_signal_trap, this function can be called any
+         * number of times, e.g., by independent subsystems that want to observe
+         * their own children. A child should only be added to one observer.
+         *
+         * @throw std::logic_error if the given SignalTrap instance does not trap Signal::sig_chld.
+         * @throw std::system_error if the process-wide reaper cannot be set up.
+         */
+        static std::unique_ptr<DeathObserver> create_with_signal_trap(
+                std::shared_ptr<SignalTrap> trap);
+
         DeathObserver(const DeathObserver&) = delete;
         virtual ~DeathObserver() = default;
 
@@ -86,9 +154,46 @@ public:
 
         /**
          * @brief child_died is emitted whenever an observed child ceases to exist.
+         *
+         * The signal is emitted without any of the observer's locks held, so
+         * subscribers may add children to the observer from within the signal.
          */
         virtual const core::Signal<ChildProcess>& child_died() const = 0;
 
+        /**
+         * @brief child_exited is emitted after child_died, describing how the child terminated.
+         *
+         * Details are collected when reaping the child, so they are
+         * available for short-lived children, too.
+         */
+        virtual const core::Signal<Exit>& child_exited() const = 0;
+
+        /**
+         * @brief exit_history returns the most recent exits of observed children, oldest first.
+         */
+        virtual std::vector<Exit> exit_history() const = 0;
+
+        /**
+         * @brief set_exit_history_size adjusts the number of exits kept in the history, discarding the oldest ones.
+         */
+        virtual void set_exit_history_size(std::size_t size) = 0;
+
+        /**
+         * @brief set_orphan_policy adjusts how the observer treats orphaned descendants.
+         *
+         * Orphans are checked on whenever a SIGCHLD is received. With
+         * OrphanPolicy::kill_and_reap, the leftover subtree of a dead child
+         * is thus killed level by level, right after the child has died.
+         *
+         * @throw std::system_error if this process cannot be marked as a subreaper.
+         */
+        virtual void set_orphan_policy(OrphanPolicy policy) = 0;
+
+        /**
+         * @brief orphan_died is emitted whenever an orphaned descendant has been reaped.
+         */
+        virtual const core::Signal<Exit>& orphan_died() const = 0;
+
         /**
          * @brief Checks and reaps all child processes registered with the observer instance.
          */
@@ -98,6 +203,31 @@ public:
         DeathObserver() = default;
     };
 
+    /**
+     * @brief DestructionPolicy enumerates what happens to a child once the last ChildProcess instance referring to it is destroyed.
+     *
+     * Children are reaped in the background by the same library-managed
+     * thread that serves exit_future, so destruction never blocks. Children
+     * are killed and reaped via pidfds, on kernels without pidfd support
+     * they are left alone.
+     */
+    enum class DestructionPolicy
+    {
+        kill_and_reap, ///< The child is killed and reaped, the default.
+        reap, ///< The child keeps running, and is reaped once it terminates.
+        keep_running ///< The child keeps running, reaping it is left to somebody else.
+    };
+
+    /**
+     * @brief Adjusts the policy applied to children that do not adjust it themselves.
+     */
+    static void set_default_destruction_policy(DestructionPolicy policy);
+
+    /**
+     * @brief Returns the policy applied to children that do not adjust it themselves.
+     */
+    static DestructionPolicy default_destruction_policy();
+
     /**
      * @brief Creates an invalid ChildProcess.
      * @return An invalid ChildProcess instance.
@@ -114,6 +244,53 @@ public:
      */
     wait::Result wait_for(const wait::Flags& flags);
 
+    /**
+     * @brief Wait for the child process to change state, giving up after timeout.
+     *
+     * Termination of the child is waited for without polling, by means of a
+     * pidfd. Stopped and continued children, or kernels without pidfd
+     * support, are checked on with a granularity of 10ms.
+     *
+     * @param [in] flags Alters the behavior of the wait operation.
+     * @param [in] timeout The maximum time to wait for.
+     * @return Result of the wait operation, Status::no_state_change if the timeout expired.
+     * @throw std::system_error in case of errors.
+     */
+    wait::Result wait_for(const wait::Flags& flags, const std::chrono::nanoseconds& timeout);
+
+    /**
+     * @brief Wait for the child process to change state, giving up at deadline.
+     * @param [in] flags Alters the behavior of the wait operation.
+     * @param [in] deadline The point in time to give up at.
+     * @return Result of the wait operation, Status::no_state_change if the deadline passed.
+     * @throw std::system_error in case of errors.
+     */
+    wait::Result wait_until(const wait::Flags& flags, const std::chrono::steady_clock::time_point& deadline);
+
+    /**
+     * @brief Returns a future that becomes ready once the child process has terminated.
+     *
+     * The child is reaped by a single thread managed by the library, which
+     * serves the exit futures of all children, so waiting for many children
+     * does not require a thread per child, nor a SignalTrap and a DeathObserver.
+     * The result has Status::undefined if the child has been reaped by somebody
+     * else. Do not combine with other ways of reaping the child. Repeated calls
+     * return the same future.
+     *
+     * @throw std::system_error if the child cannot be watched, e.g., on kernels without pidfd support.
+     */
+    std::shared_future<wait::Result> exit_future();
+
+    /**
+     * @brief Adjusts what happens to the child once the last ChildProcess instance referring to it is destroyed.
+     */
+    void set_destruction_policy(DestructionPolicy policy);
+
+    /**
+     * @brief Returns what happens to the child once the last ChildProcess instance referring to it is destroyed.
+     */
+    DestructionPolicy destruction_policy() const;
+
     /**
      * @brief Access this process's stderr.
      */
@@ -129,9 +306,28 @@ public:
      */
     std::istream& cout();
 
+    /**
+     * @brief Flushes cin() and closes our end of this process's stdin, signalling end-of-file to the child.
+     *
+     * Subsequent writes to cin() fail. Calling the function more than once, or for a
+     * child process without redirected stdin, has no effect.
+     */
+    void close_stdin();
+
+    /**
+     * @brief Accesses the file descriptor backing one of this process's redirected standard streams.
+     *
+     * Data buffered by cerr(), cin() or cout() is not visible through the
+     * returned file descriptor. Do not mix both ways of accessing the same stream.
+     *
+     * @param [in] stream One of StandardStream::stdin, StandardStream::stdout or StandardStream::stderr.
+     * @return The file descriptor, or -1 if the stream has not been redirected.
+     */
+    int native_handle(StandardStream stream) const;
+
 private:
-    friend ChildProcess fork(const std::function<posix::exit::Status()>&, const StandardStream&);
-    friend ChildProcess vfork(const std::function<posix::exit::Status()>&, const StandardStream&);
+    friend ChildProcess fork(const std::function<posix::exit::Status()>&, const StandardStream&, const Grouping&);
+    friend ChildProcess vfork(const std::function<posix::exit::Status()>&, const StandardStream&, const Grouping&);
 
     class CORE_POSIX_DLL_LOCAL Pipe
     {
@@ -163,6 +359,76 @@ private:
     struct CORE_POSIX_DLL_LOCAL Private;
     std::shared_ptr<Private> d;
 };
+
+namespace wait
+{
+/**
+ * @brief The Change struct describes the termination of one child in a set of children.
+ */
+struct CORE_POSIX_DLL_PUBLIC Change
+{
+    std::size_t index; ///< The index of the child in the set.
+    Result result; ///< Status::undefined if the child has been reaped by somebody else.
+};
+}
+
+/**
+ * @brief Waits until any of the given children has terminated, and reaps all children that have terminated by then.
+ *
+ * Children are waited for by means of their pidfds and a single epoll
+ * instance, such that the cost of a wakeup does not depend on the number
+ * of children. On kernels without pidfd support, children are checked
+ * with a granularity of 10ms.
+ *
+ * @param [in] children The set of children to wait for.
+ * @return The changes of the children that have terminated, empty if children is empty.
+ * @throw std::system_error in case of errors.
+ */
+CORE_POSIX_DLL_PUBLIC std::vector<wait::Change> wait_any(const std::vector<ChildProcess>& children);
+
+/**
+ * @brief Waits until any of the given children has terminated, giving up at deadline.
+ * @return The changes of the children that have terminated, empty if the deadline passed.
+ * @throw std::system_error in case of errors.
+ */
+CORE_POSIX_DLL_PUBLIC std::vector<wait::Change> wait_any(
+        const std::vector<ChildProcess>& children,
+        const std::chrono::steady_clock::time_point& deadline);
+
+/**
+ * @brief Waits until all of the given children have terminated, reaping them.
+ * @return The changes of all children, in order of termination.
+ * @throw std::system_error in case of errors.
+ */
+CORE_POSIX_DLL_PUBLIC std::vector<wait::Change> wait_all(const std::vector<ChildProcess>& children);
+
+/**
+ * @brief Waits until all of the given children have terminated, giving up at deadline.
+ * @return The changes of the children that have terminated before the deadline passed, in order of termination.
+ * @throw std::system_error in case of errors.
+ */
+CORE_POSIX_DLL_PUBLIC std::vector<wait::Change> wait_all(
+        const std::vector<ChildProcess>& children,
+        const std::chrono::steady_clock::time_point& deadline);
+
+/**
+ * @brief Terminates a set of children gracefully, bounded by a grace period.
+ *
+ * All children are sent signal at once, and waited for concurrently until
+ * the grace period has expired. Children still alive by then are killed with
+ * Signal::sig_kill. All children are reaped, so the time taken to shut down
+ * is bounded by the grace period, independent of the number of children.
+ *
+ * @param [in] children The set of children to terminate.
+ * @param [in] grace_period The time given to the children to terminate after having been signalled.
+ * @param [in] signal The signal asking the children to terminate.
+ * @return The changes of all children, in order of termination.
+ * @throw std::system_error in case of errors.
+ */
+CORE_POSIX_DLL_PUBLIC std::vector<wait::Change> shutdown(
+        const std::vector<ChildProcess>& children,
+        const std::chrono::nanoseconds& grace_period,
+        Signal signal = Signal::sig_term);
 }
 }
 
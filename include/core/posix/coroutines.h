@@ -0,0 +1,404 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Thomas Voß <thomas.voss@canonical.com>
+ */
+
+#ifndef CORE_POSIX_COROUTINES_H_
+#define CORE_POSIX_COROUTINES_H_
+
+#if __cplusplus < 202002L
+#error "core/posix/coroutines.h requires C++20. Build with -std=c++20 and link against process-cpp-coroutines."
+#endif
+
+#include <core/posix/child_process.h>
+#include <core/posix/io_engine.h>
+#include <core/posix/standard_stream.h>
+#include <core/posix/visibility.h>
+#include <core/posix/wait.h>
+
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <span>
+#include <system_error>
+#include <utility>
+
+namespace core
+{
+namespace posix
+{
+/**
+ * @brief C++20 coroutine support for interacting with child processes.
+ *
+ * The types in this namespace live in the separate library
+ * process-cpp-coroutines, which is only built if process-cpp is configured
+ * with -DPROCESS_CPP_ENABLE_COROUTINES=ON. The C++11 API of process-cpp is
+ * not affected.
+ *
+ * @code
+ * core::posix::coroutines::Task<> drain(core::posix::coroutines::Child& child)
+ * {
+ *     char buffer[4096];
+ *     while (auto size = co_await child.read_some(buffer))
+ *         consume(buffer, size);
+ *
+ *     auto result = co_await child.exited();
+ * }
+ *
+ * core::posix::coroutines::Executor executor;
+ * core::posix::coroutines::Child child{executor, core::posix::fork(...)};
+ *
+ * executor.spawn(drain(child));
+ * executor.run();
+ * @endcode
+ *
+ * Note that a coroutine lambda's captures live in the closure object, not in
+ * the coroutine frame. Prefer passing state as parameters to spawned coroutines.
+ */
+namespace coroutines
+{
+template<typename T = void>
+class Task;
+
+namespace detail
+{
+struct PromiseBase
+{
+    // Resumes whoever awaits the task once it has finished.
+    struct FinalAwaiter
+    {
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+        {
+            auto continuation = handle.promise().continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+    };
+
+    std::suspend_always initial_suspend() const noexcept
+    {
+        return {};
+    }
+
+    FinalAwaiter final_suspend() const noexcept
+    {
+        return {};
+    }
+
+    void unhandled_exception() noexcept
+    {
+        exception = std::current_exception();
+    }
+
+    void rethrow_if_failed() const
+    {
+        if (exception)
+            std::rethrow_exception(exception);
+    }
+
+    std::coroutine_handle<> continuation;
+    std::exception_ptr exception;
+};
+
+template<typename T>
+struct Promise : public PromiseBase
+{
+    Task<T> get_return_object() noexcept;
+
+    void return_value(T t)
+    {
+        value.emplace(std::move(t));
+    }
+
+    T result()
+    {
+        rethrow_if_failed();
+        return std::move(*value);
+    }
+
+    std::optional<T> value;
+};
+
+template<>
+struct Promise<void> : public PromiseBase
+{
+    Task<void> get_return_object() noexcept;
+
+    void return_void() const noexcept
+    {
+    }
+
+    void result() const
+    {
+        rethrow_if_failed();
+    }
+};
+}
+
+/**
+ * @brief The Task class models a lazily started coroutine producing a T.
+ *
+ * A task starts executing when it is awaited, and resumes the awaiting
+ * coroutine once it has finished. Exceptions escaping the task are rethrown
+ * to the awaiting coroutine. Use Executor::spawn to start top-level tasks.
+ */
+template<typename T>
+class Task
+{
+public:
+    typedef detail::Promise<T> promise_type;
+
+    Task(const Task&) = delete;
+    Task(Task&& rhs) noexcept : handle(std::exchange(rhs.handle, nullptr))
+    {
+    }
+
+    ~Task()
+    {
+        if (handle)
+            handle.destroy();
+    }
+
+    Task& operator=(const Task&) = delete;
+    Task& operator=(Task&& rhs) noexcept
+    {
+        if (this != &rhs)
+        {
+            if (handle)
+                handle.destroy();
+            handle = std::exchange(rhs.handle, nullptr);
+        }
+        return *this;
+    }
+
+    bool await_ready() const noexcept
+    {
+        return !handle || handle.done();
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+
+    T await_resume()
+    {
+        return handle.promise().result();
+    }
+
+private:
+    friend promise_type;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) noexcept : handle(handle)
+    {
+    }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+namespace detail
+{
+template<typename T>
+inline Task<T> Promise<T>::get_return_object() noexcept
+{
+    return Task<T>{std::coroutine_handle<Promise<T>>::from_promise(*this)};
+}
+
+inline Task<void> Promise<void>::get_return_object() noexcept
+{
+    return Task<void>{std::coroutine_handle<Promise<void>>::from_promise(*this)};
+}
+}
+
+class Executor;
+
+/**
+ * @brief Awaitable that completes once a file descriptor has become readable.
+ * @throw std::system_error from co_await if waiting fails.
+ */
+class CORE_POSIX_DLL_PUBLIC Readable
+{
+public:
+    Readable(IoEngine& engine, int fd);
+
+    bool await_ready() const noexcept;
+    bool await_suspend(std::coroutine_handle<> handle);
+    void await_resume() const;
+
+private:
+    IoEngine& engine;
+    int fd;
+    std::coroutine_handle<> handle;
+    std::error_code error;
+    bool suspended;
+    bool done;
+};
+
+/**
+ * @brief Awaitable that writes some bytes of a buffer to a file descriptor, yielding the number of bytes written.
+ * @throw std::system_error from co_await if writing fails.
+ */
+class CORE_POSIX_DLL_PUBLIC WriteSome
+{
+public:
+    WriteSome(IoEngine& engine, int fd, std::span<const char> buffer);
+
+    bool await_ready() const noexcept;
+    bool await_suspend(std::coroutine_handle<> handle);
+    std::size_t await_resume() const;
+
+private:
+    IoEngine& engine;
+    int fd;
+    std::span<const char> buffer;
+    std::coroutine_handle<> handle;
+    std::size_t size;
+    std::error_code error;
+    bool suspended;
+    bool done;
+};
+
+/**
+ * @brief The Executor class runs coroutines on a single thread, driven by an IoEngine.
+ *
+ * All coroutines spawned on an executor are resumed on the thread executing
+ * Executor::run(). Waiting for a child or one of its pipes does not block
+ * that thread, so a single executor handles thousands of children without
+ * dedicating a thread to each of them.
+ */
+class CORE_POSIX_DLL_PUBLIC Executor
+{
+public:
+    /**
+     * @brief Creates an executor driven by an IoEngine based on epoll.
+     * @throw std::system_error in case of errors.
+     */
+    Executor();
+
+    /**
+     * @brief Creates an executor driven by the given engine.
+     */
+    explicit Executor(const std::shared_ptr<IoEngine>& engine);
+
+    Executor(const Executor&) = delete;
+    ~Executor();
+
+    Executor& operator=(const Executor&) = delete;
+    bool operator==(const Executor&) const = delete;
+
+    /**
+     * @brief Returns the engine driving this executor.
+     */
+    const std::shared_ptr<IoEngine>& engine() const;
+
+    /**
+     * @brief Schedules task for execution on the thread running the executor.
+     *
+     * Tasks have to be spawned before or while run() is executing, and have to
+     * be run to completion before the executor is destroyed.
+     */
+    void spawn(Task<void> task);
+
+    /**
+     * @brief Runs the executor until all spawned tasks have completed.
+     * @throw The first exception that escaped a spawned task.
+     */
+    void run();
+
+    /**
+     * @brief Returns an awaitable that completes once fd has become readable.
+     */
+    Readable readable(int fd);
+
+    /**
+     * @brief Returns an awaitable that writes some bytes of buffer to fd.
+     */
+    WriteSome write_some(int fd, std::span<const char> buffer);
+
+private:
+    struct CORE_POSIX_DLL_LOCAL Private;
+    std::shared_ptr<Private> d;
+};
+
+/**
+ * @brief The Child class exposes the exit and the pipes of a child process as awaitables.
+ *
+ * The child's redirected pipes are switched to non-blocking mode, do not use
+ * the streams of the ChildProcess alongside. A Child has to outlive all
+ * operations started on it.
+ */
+class CORE_POSIX_DLL_PUBLIC Child
+{
+public:
+    /**
+     * @brief Wraps child for use with coroutines running on executor.
+     * @throw std::system_error if no pidfd can be obtained for child.
+     */
+    Child(Executor& executor, const ChildProcess& child);
+
+    /**
+     * @brief Returns the wrapped child process.
+     */
+    ChildProcess& process();
+
+    /**
+     * @brief Completes once the child has terminated, yielding the result of reaping it.
+     *
+     * Only a single coroutine should await the exit of a child.
+     */
+    Task<wait::Result> exited();
+
+    /**
+     * @brief Reads some bytes from the child's stdout, yielding 0 on end-of-file.
+     * @throw std::logic_error if stdout of the child has not been redirected.
+     * @throw std::system_error in case of errors.
+     */
+    Task<std::size_t> read_some(std::span<char> buffer);
+
+    /**
+     * @brief Reads some bytes from the child's stdout or stderr, yielding 0 on end-of-file.
+     * @throw std::logic_error if the stream has not been redirected.
+     * @throw std::system_error in case of errors.
+     */
+    Task<std::size_t> read_some(StandardStream stream, std::span<char> buffer);
+
+    /**
+     * @brief Writes the complete buffer to the child's stdin.
+     * @throw std::logic_error if stdin of the child has not been redirected.
+     * @throw std::system_error in case of errors.
+     */
+    Task<void> write(std::span<const char> buffer);
+
+private:
+    struct CORE_POSIX_DLL_LOCAL Private;
+    std::shared_ptr<Private> d;
+};
+}
+}
+}
+
+#endif // CORE_POSIX_COROUTINES_H_
@@ -48,6 +48,34 @@ CORE_POSIX_DLL_PUBLIC ChildProcess fork(const std::function<posix::exit::Status(
  */
 CORE_POSIX_DLL_PUBLIC ChildProcess vfork(const std::function<posix::exit::Status()>& main,
                    const StandardStream& flags);
+
+/**
+ * @brief fork forks a new process, placed as described by grouping, and executes the provided main function in it.
+ *
+ * The child has been placed by the time the call returns, so signals and
+ * waits targeting its process group reach it from then on.
+ *
+ * @throws std::system_error in case of errors.
+ * @param [in] main The main function of the newly forked process.
+ * @param [in] flags Specify which standard streams should be redirected to the parent process.
+ * @param [in] grouping The process group and session of the new process.
+ * @return An instance of ChildProcess in case of success.
+ */
+CORE_POSIX_DLL_PUBLIC ChildProcess fork(const std::function<posix::exit::Status()>& main,
+                                   const StandardStream& flags,
+                                   const Grouping& grouping);
+
+/**
+ * @brief vfork vforks a new process, placed as described by grouping, and executes the provided main function in it.
+ * @throws std::system_error in case of errors.
+ * @param [in] main The main function of the newly forked process.
+ * @param [in] flags Specify which standard streams should be redirected to the parent process.
+ * @param [in] grouping The process group and session of the new process.
+ * @return An instance of ChildProcess in case of success.
+ */
+CORE_POSIX_DLL_PUBLIC ChildProcess vfork(const std::function<posix::exit::Status()>& main,
+                   const StandardStream& flags,
+                   const Grouping& grouping);
 }
 }
 
@@ -0,0 +1,174 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Thomas Voß <thomas.voss@canonical.com>
+ */
+
+#ifndef CORE_POSIX_IO_ENGINE_H_
+#define CORE_POSIX_IO_ENGINE_H_
+
+#include <core/posix/visibility.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <functional>
+#include <memory>
+#include <system_error>
+
+#include <sys/uio.h>
+
+namespace core
+{
+namespace posix
+{
+/**
+ * @brief The IoEngine class multiplexes asynchronous operations on file descriptors, e.g., the pipes of child processes.
+ *
+ * All handlers are invoked on the thread executing run(). Operations can be
+ * started from any thread, they take effect once the engine picks them up.
+ * File descriptors handed to the engine might have their O_NONBLOCK flag
+ * adjusted to whatever suits the backend best, and must stay open until all
+ * operations on them have completed or have been cancelled.
+ *
+ * While running, the engine blocks SIGPIPE for its thread. Writing to a pipe
+ * whose reader has gone away thus results in std::errc::broken_pipe being
+ * reported to the respective handler instead of terminating the process.
+ */
+class CORE_POSIX_DLL_PUBLIC IoEngine
+{
+public:
+    /**
+     * @brief Backend enumerates the kernel interfaces an engine can be built upon.
+     */
+    enum class Backend
+    {
+        epoll, ///< Readiness notification via epoll, followed by a system call per operation.
+        io_uring ///< Batched submission and completion via io_uring, with multishot reads into kernel-selected buffers.
+    };
+
+    /**
+     * @brief The Statistics struct summarizes the work an engine has carried out so far.
+     */
+    struct Statistics
+    {
+        std::uint64_t system_calls; ///< Number of system calls issued for waiting, wakeups and transferring data.
+        std::uint64_t bytes_read; ///< Number of bytes handed to read handlers.
+        std::uint64_t bytes_written; ///< Number of bytes reported to write handlers.
+    };
+
+    /**
+     * @brief Invoked for every chunk of data read from a file descriptor.
+     *
+     * data is only valid for the duration of the call. A size of 0 without
+     * an error indicates end-of-file.
+     */
+    typedef std::function<void(const char* data, std::size_t size, const std::error_code& e)> ReadHandler;
+
+    /**
+     * @brief Invoked once a write operation has completed, with the number of bytes written.
+     */
+    typedef std::function<void(std::size_t size, const std::error_code& e)> WriteHandler;
+
+    /**
+     * @brief Invoked once a file descriptor has become readable.
+     */
+    typedef std::function<void(const std::error_code& e)> WaitHandler;
+
+    IoEngine(const IoEngine&) = delete;
+    virtual ~IoEngine() = default;
+
+    IoEngine& operator=(const IoEngine&) = delete;
+    bool operator==(const IoEngine&) const = delete;
+
+    /**
+     * @brief Starts reading from fd, invoking handler for every chunk of data.
+     *
+     * Reading continues until end-of-file, an error or until cancel(fd) is called.
+     * Only one reader can be active per file descriptor.
+     */
+    virtual void start_reading(int fd, const ReadHandler& handler) = 0;
+
+    /**
+     * @brief Writes the given buffers to fd with a single gathering write, once fd is writable.
+     *
+     * The iovec array is copied, the memory it points to has to stay valid until
+     * handler has been invoked. Write operations on the same fd complete in order.
+     */
+    virtual void async_write_some(int fd, const ::iovec* iov, int count, const WriteHandler& handler) = 0;
+
+    /**
+     * @brief Invokes handler once fd is readable, without reading from it.
+     */
+    virtual void async_wait_readable(int fd, const WaitHandler& handler) = 0;
+
+    /**
+     * @brief Cancels all pending operations on fd.
+     *
+     * Pending handlers are invoked with std::errc::operation_canceled.
+     */
+    virtual void cancel(int fd) = 0;
+
+    /**
+     * @brief Queues a function for execution on the thread running the engine.
+     */
+    virtual void post(const std::function<void()>& task) = 0;
+
+    /**
+     * @brief Runs the engine, dispatching completed operations. The call blocks until stop is called.
+     */
+    virtual void run() = 0;
+
+    /**
+     * @brief Makes run() return as soon as possible.
+     *
+     * If the engine is not running, the next call to run() returns immediately.
+     */
+    virtual void stop() = 0;
+
+    /**
+     * @brief Returns the backend this engine is built upon.
+     */
+    virtual Backend backend() const = 0;
+
+    /**
+     * @brief Returns a snapshot of the engine's statistics. Thread-safe.
+     */
+    virtual Statistics statistics() const = 0;
+
+protected:
+    IoEngine() = default;
+};
+
+/**
+ * @brief Creates an IoEngine based on epoll.
+ * @throw std::system_error in case of errors.
+ */
+CORE_POSIX_DLL_PUBLIC std::shared_ptr<IoEngine> create_io_engine();
+
+/**
+ * @brief Creates an IoEngine based on the given backend.
+ *
+ * If io_uring is requested but not available, e.g., because the kernel is too
+ * old or because io_uring has been disabled by the administrator, an engine
+ * based on epoll is returned instead. Query IoEngine::backend() to find out.
+ *
+ * @throw std::system_error in case of errors.
+ */
+CORE_POSIX_DLL_PUBLIC std::shared_ptr<IoEngine> create_io_engine(IoEngine::Backend backend);
+}
+}
+
+#endif // CORE_POSIX_IO_ENGINE_H_
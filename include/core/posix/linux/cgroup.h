@@ -0,0 +1,219 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Thomas Voß <thomas.voss@canonical.com>
+ */
+
+#ifndef CORE_POSIX_LINUX_CGROUP_H_
+#define CORE_POSIX_LINUX_CGROUP_H_
+
+#include <core/posix/visibility.h>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace core
+{
+namespace posix
+{
+class Process;
+namespace linux
+{
+/**
+ * @brief The Cgroup class models a cgroup v2 as a job object for a tree of processes.
+ *
+ * All processes in a cgroup, including the ones they fork, can be frozen,
+ * thawed and killed with a single write, independent of their number.
+ * Resource consumption is accounted for the cgroup as a whole.
+ *
+ * Place children in a cgroup when spawning them, such that they cannot fork
+ * before being contained:
+ *
+ * @code
+ * auto job = core::posix::linux::Cgroup::of_this_process_or_throw().create_child_or_throw("job");
+ * auto child = core::posix::exec(program, argv, env, flags, job.enter_in_child());
+ * ...
+ * job.kill_or_throw();
+ * @endcode
+ *
+ * Operating on a cgroup requires write access to its files, e.g., via
+ * delegation of a subtree to the calling user. The class is implicitly
+ * shared, and refers to the cgroup via an open directory.
+ */
+class CORE_POSIX_DLL_PUBLIC Cgroup
+{
+public:
+    /**
+     * @brief The CpuStat struct summarizes the CPU time consumed by all processes in a cgroup.
+     */
+    struct CpuStat
+    {
+        std::chrono::microseconds usage{0}; ///< Total CPU time.
+        std::chrono::microseconds user{0}; ///< CPU time spent in user mode.
+        std::chrono::microseconds system{0}; ///< CPU time spent in kernel mode.
+    };
+
+    /**
+     * @brief Returns the cgroup v2 the calling process belongs to.
+     * @throw std::system_error if no cgroup v2 hierarchy is mounted.
+     */
+    static Cgroup of_this_process_or_throw();
+
+    /**
+     * @brief Opens the cgroup at path, an absolute path into a mounted cgroup v2 hierarchy.
+     * @throw std::system_error in case of errors.
+     */
+    static Cgroup open_or_throw(const std::string& path);
+
+    /**
+     * @brief Creates a cgroup called name below this cgroup, or opens it if it exists already.
+     * @throw std::system_error in case of errors.
+     */
+    Cgroup create_child_or_throw(const std::string& name) const;
+
+    /**
+     * @brief Returns the absolute path of this cgroup.
+     */
+    const std::string& path() const;
+
+    /**
+     * @brief Moves process into this cgroup.
+     *
+     * Processes forked by process before the move stay where they are.
+     * Prefer enter_in_child() for children that are yet to be spawned.
+     *
+     * @throw std::system_error in case of errors.
+     */
+    void add_or_throw(const Process& process);
+
+    /**
+     * @brief Moves process into this cgroup.
+     * @param [out] e Set to contain an error if an issue arises.
+     */
+    void add(const Process& process, std::error_code& e) noexcept(true);
+
+    /**
+     * @brief Returns a function that moves the calling process into this cgroup.
+     *
+     * Pass the function as child_setup to exec(), or call it first thing in
+     * the main function handed to fork(). The child is then contained before
+     * it runs any code of its own. Errors terminate the child.
+     */
+    std::function<void()> enter_in_child() const;
+
+    /**
+     * @brief Returns the pids of all processes in this cgroup, excluding the ones in child cgroups.
+     * @throw std::system_error in case of errors.
+     */
+    std::vector<pid_t> processes_or_throw() const;
+
+    /**
+     * @brief Returns true if this cgroup or any of its descendants contains processes.
+     * @throw std::system_error in case of errors.
+     */
+    bool is_populated_or_throw() const;
+
+    /**
+     * @brief Asks the kernel to freeze all processes in this cgroup and its descendants.
+     *
+     * Freezing completes asynchronously, see is_frozen_or_throw().
+     *
+     * @throw std::system_error in case of errors.
+     */
+    void freeze_or_throw();
+
+    /**
+     * @brief Asks the kernel to freeze all processes in this cgroup and its descendants.
+     * @param [out] e Set to contain an error if an issue arises.
+     */
+    void freeze(std::error_code& e) noexcept(true);
+
+    /**
+     * @brief Thaws all processes in this cgroup and its descendants.
+     * @throw std::system_error in case of errors.
+     */
+    void thaw_or_throw();
+
+    /**
+     * @brief Thaws all processes in this cgroup and its descendants.
+     * @param [out] e Set to contain an error if an issue arises.
+     */
+    void thaw(std::error_code& e) noexcept(true);
+
+    /**
+     * @brief Returns true once all processes in this cgroup have been frozen.
+     * @throw std::system_error in case of errors.
+     */
+    bool is_frozen_or_throw() const;
+
+    /**
+     * @brief Sends SIGKILL to all processes in this cgroup and its descendants.
+     *
+     * Relies on cgroup.kill, which does not race with processes forking.
+     * Older kernels lack cgroup.kill, and the processes are frozen, signalled
+     * one by one and thawed instead.
+     *
+     * @throw std::system_error in case of errors.
+     */
+    void kill_or_throw();
+
+    /**
+     * @brief Sends SIGKILL to all processes in this cgroup and its descendants.
+     * @param [out] e Set to contain an error if an issue arises.
+     */
+    void kill(std::error_code& e) noexcept(true);
+
+    /**
+     * @brief Reports the CPU time consumed by all processes that ever ran in this cgroup.
+     * @throw std::system_error in case of errors.
+     */
+    CpuStat cpu_stat_or_throw() const;
+
+    /**
+     * @brief Reports the memory currently used by this cgroup and its descendants, in bytes.
+     * @throw std::system_error in case of errors, e.g., if the memory controller is not enabled.
+     */
+    std::uint64_t memory_current_or_throw() const;
+
+    /**
+     * @brief Removes this cgroup, which must not contain any processes or child cgroups.
+     * @throw std::system_error in case of errors.
+     */
+    void remove_or_throw();
+
+    /**
+     * @brief Removes this cgroup, which must not contain any processes or child cgroups.
+     * @param [out] e Set to contain an error if an issue arises.
+     */
+    void remove(std::error_code& e) noexcept(true);
+
+private:
+    struct CORE_POSIX_DLL_LOCAL Private;
+    CORE_POSIX_DLL_LOCAL explicit Cgroup(const std::shared_ptr<Private>& d);
+
+    std::shared_ptr<Private> d;
+};
+}
+}
+}
+
+#endif // CORE_POSIX_LINUX_CGROUP_H_
@@ -0,0 +1,130 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Thomas Voß <thomas.voss@canonical.com>
+ */
+
+#ifndef CORE_POSIX_LINUX_PROC_PROCESS_TREE_H_
+#define CORE_POSIX_LINUX_PROC_PROCESS_TREE_H_
+
+#include <core/posix/signal.h>
+#include <core/posix/visibility.h>
+
+#include <cstddef>
+#include <memory>
+#include <system_error>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace core
+{
+namespace posix
+{
+namespace linux
+{
+namespace proc
+{
+/**
+ * @brief The ProcessTree class is a snapshot of the parent/child relation of all processes.
+ *
+ * A snapshot is taken by scanning /proc once, and indexes the children of
+ * every process. Queries thus only touch the part of the tree they are
+ * interested in, instead of rescanning /proc for every level. In contrast
+ * to process groups and sessions, the tree also covers descendants that
+ * called setsid or setpgid.
+ *
+ * Processes keep on forking and exiting after the snapshot has been taken,
+ * i.e., a snapshot is only ever a hint. The process tree class is implicitly
+ * shared.
+ */
+class CORE_POSIX_DLL_PUBLIC ProcessTree
+{
+public:
+    /**
+     * @brief Scans /proc and indexes all processes visible to the caller.
+     * @throw std::system_error in case of errors.
+     */
+    static ProcessTree snapshot_or_throw();
+
+    /**
+     * @brief Returns the number of processes in the snapshot.
+     */
+    std::size_t size() const;
+
+    /**
+     * @brief Checks if pid has been present when the snapshot was taken.
+     */
+    bool contains(pid_t pid) const;
+
+    /**
+     * @brief Returns the parent of pid, or -1 if pid is not part of the snapshot.
+     */
+    pid_t parent_of(pid_t pid) const;
+
+    /**
+     * @brief Returns the direct children of pid.
+     */
+    const std::vector<pid_t>& children_of(pid_t pid) const;
+
+    /**
+     * @brief Returns pid and all of its descendants, parents ahead of their children.
+     *
+     * Runs in time proportional to the size of the subtree. Returns an empty
+     * vector if pid is not part of the snapshot.
+     */
+    std::vector<pid_t> subtree_of(pid_t pid) const;
+
+private:
+    struct CORE_POSIX_DLL_LOCAL Private;
+    CORE_POSIX_DLL_LOCAL ProcessTree(const std::shared_ptr<Private>& d);
+
+    std::shared_ptr<Private> d;
+};
+
+/**
+ * @brief Sends signal to pid and all of its descendants.
+ *
+ * The subtree is stopped top-down with SIGSTOP first, and /proc is rescanned
+ * until no new descendants show up. Processes forking concurrently thus
+ * cannot escape. Afterwards, signal is delivered and the subtree is
+ * continued again, unless signal is SIGKILL or SIGSTOP. Members that exit
+ * on their own in between are not considered an error. The calling process
+ * is never stopped, but signalled last if it is part of the subtree.
+ *
+ * @throw std::system_error if pid does not exist or signalling a member fails.
+ * @param [in] pid The root of the subtree.
+ * @param [in] signal The signal to be sent.
+ */
+CORE_POSIX_DLL_PUBLIC void kill_tree_or_throw(pid_t pid, Signal signal);
+
+/**
+ * @brief Sends signal to pid and all of its descendants.
+ *
+ * Refer to kill_tree_or_throw for the details. Signalling carries on with
+ * the remaining members if signalling one of them fails, e reports the first
+ * error.
+ *
+ * @param [in] pid The root of the subtree.
+ * @param [in] signal The signal to be sent.
+ * @param [out] e Set to the first error, cleared otherwise.
+ */
+CORE_POSIX_DLL_PUBLIC void kill_tree(pid_t pid, Signal signal, std::error_code& e) noexcept;
+}
+}
+}
+}
+
+#endif // CORE_POSIX_LINUX_PROC_PROCESS_TREE_H_
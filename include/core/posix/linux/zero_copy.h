@@ -0,0 +1,159 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Thomas Voß <thomas.voss@canonical.com>
+ */
+
+#ifndef CORE_POSIX_LINUX_ZERO_COPY_H_
+#define CORE_POSIX_LINUX_ZERO_COPY_H_
+
+#include <core/posix/visibility.h>
+
+#include <cstddef>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <system_error>
+
+#include <sys/types.h>
+
+namespace core
+{
+namespace posix
+{
+class ChildProcess;
+namespace linux
+{
+/**
+ * @brief vmsplice_to_stdin maps the given user pages into the stdin pipe of a child process.
+ *
+ * The call blocks until all bytes have been handed to the pipe. As the pages
+ * are referenced rather than copied, data must neither be modified nor freed
+ * before the child process has consumed it. Pending output buffered in
+ * child.cin() is flushed first to preserve ordering.
+ *
+ * @param [in] child The child process whose stdin has been redirected.
+ * @param [in] data Pointer to the bytes to feed.
+ * @param [in] size Number of bytes to feed.
+ * @param [out] e Set to contain an error if an issue arises.
+ * @return The number of bytes handed to the pipe.
+ */
+CORE_POSIX_DLL_PUBLIC std::size_t vmsplice_to_stdin(ChildProcess& child,
+                                                   const void* data,
+                                                   std::size_t size,
+                                                   std::error_code& e) noexcept(true);
+
+/**
+ * @brief vmsplice_to_stdin_or_throw maps the given user pages into the stdin pipe of a child process.
+ * @throw std::system_error in case of errors.
+ * @param [in] child The child process whose stdin has been redirected.
+ * @param [in] data Pointer to the bytes to feed, see vmsplice_to_stdin for lifetime requirements.
+ * @param [in] size Number of bytes to feed.
+ * @return The number of bytes handed to the pipe.
+ */
+CORE_POSIX_DLL_PUBLIC std::size_t vmsplice_to_stdin_or_throw(ChildProcess& child,
+                                                            const void* data,
+                                                            std::size_t size);
+
+/**
+ * @brief splice_to_stdin moves a range of a file into the stdin pipe of a child process.
+ *
+ * Uses splice and falls back to sendfile and, finally, to plain read/write
+ * if the file system does not support either of them. The call blocks until
+ * size bytes have been transferred or end-of-file is reached. The file offset
+ * of fd is not changed.
+ *
+ * @param [in] child The child process whose stdin has been redirected.
+ * @param [in] fd The file to read from.
+ * @param [in] offset Offset in the file to start reading at.
+ * @param [in] size Number of bytes to transfer.
+ * @param [out] e Set to contain an error if an issue arises.
+ * @return The number of bytes transferred.
+ */
+CORE_POSIX_DLL_PUBLIC std::size_t splice_to_stdin(ChildProcess& child,
+                                                 int fd,
+                                                 off_t offset,
+                                                 std::size_t size,
+                                                 std::error_code& e) noexcept(true);
+
+/**
+ * @brief splice_to_stdin_or_throw moves a range of a file into the stdin pipe of a child process.
+ * @throw std::system_error in case of errors.
+ * @param [in] child The child process whose stdin has been redirected.
+ * @param [in] fd The file to read from.
+ * @param [in] offset Offset in the file to start reading at.
+ * @param [in] size Number of bytes to transfer.
+ * @return The number of bytes transferred.
+ */
+CORE_POSIX_DLL_PUBLIC std::size_t splice_to_stdin_or_throw(ChildProcess& child,
+                                                          int fd,
+                                                          off_t offset,
+                                                          std::size_t size);
+
+/**
+ * @brief The SealedMemoryFile class models an immutable, memory-backed file that can serve as a child's stdin.
+ *
+ * The contents are written once into a memfd which is then sealed against
+ * writing, growing and shrinking. A child process that receives the file as
+ * its stdin can thus safely mmap it instead of reading through a pipe.
+ *
+ * The class is implicitly shared, the memfd is closed with the last copy.
+ */
+class CORE_POSIX_DLL_PUBLIC SealedMemoryFile
+{
+public:
+    /**
+     * @brief Creates a new sealed file with a copy of the given bytes.
+     * @throw std::system_error in case of errors.
+     * @param [in] name Name of the file, for debugging purposes only.
+     * @param [in] data Pointer to the contents.
+     * @param [in] size Number of bytes pointed to by data.
+     * @return A sealed file holding size bytes.
+     */
+    static SealedMemoryFile create_or_throw(const std::string& name,
+                                            const void* data,
+                                            std::size_t size);
+
+    /**
+     * @brief Accesses the underlying file descriptor.
+     */
+    int native_handle() const;
+
+    /**
+     * @brief Returns the size of the file in bytes.
+     */
+    std::size_t size() const;
+
+    /**
+     * @brief Returns a function that makes the file the stdin of the calling process.
+     *
+     * Pass the function as child_setup to exec, or invoke it from within the
+     * main function handed to fork. The file is reopened so that every child
+     * reads from offset 0, independent of other children.
+     */
+    std::function<void()> redirect_to_stdin() const;
+
+private:
+    CORE_POSIX_DLL_LOCAL SealedMemoryFile(int fd, std::size_t size);
+
+    struct CORE_POSIX_DLL_LOCAL Private;
+    std::shared_ptr<Private> d;
+};
+}
+}
+}
+
+#endif // CORE_POSIX_LINUX_ZERO_COPY_H_
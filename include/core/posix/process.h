@@ -39,7 +39,8 @@ class WaitFlags;
 /**
  * @brief The Process class models a process and possible operations on it.
  *
- * The process class is implicitly shared.
+ * The process class is a cheap to copy value. Processes obtained from
+ * open_or_throw share their pidfd between copies.
  */
 class CORE_POSIX_DLL_PUBLIC Process : public Signalable
 {
@@ -51,6 +52,31 @@ public:
      */
     explicit Process(pid_t pid);
 
+    /**
+     * @brief Opens a handle to an existing process that need not be a child of this process.
+     *
+     * The handle refers to the process via a pidfd. Signals sent through the
+     * handle never end up with an unrelated process that recycled pid, and
+     * pidfd() becomes readable once the process has terminated. Register the
+     * pidfds with an IoEngine to monitor many processes without polling /proc.
+     *
+     * @throw std::system_error if the process does not exist or no pidfd can be obtained.
+     * @param pid The process identifier of the existing process.
+     */
+    static Process open_or_throw(pid_t pid);
+
+    /**
+     * @brief Opens a handle to an existing process, provided it has been started at start_time.
+     *
+     * A pid together with the start time of a process identifies the process
+     * even across pid reuse, e.g., when handed over from another process.
+     *
+     * @throw std::system_error with std::errc::no_such_process if pid has been recycled.
+     * @param pid The process identifier of the existing process.
+     * @param start_time The time the process started after system boot, in clock ticks.
+     */
+    static Process open_or_throw(pid_t pid, long int start_time);
+
     /**
      * @brief Returns an invalid instance for testing purposes.
      * @return An invalid instance.
@@ -84,9 +110,29 @@ public:
      */
     virtual ProcessGroup process_group(std::error_code& se) const noexcept(true);
 
+    /**
+     * @brief Returns the time the process started after system boot, in clock ticks.
+     *
+     * Only known for processes obtained from open_or_throw, -1 otherwise.
+     */
+    virtual long int start_time() const;
+
+    /**
+     * @brief Checks without blocking whether the process has terminated.
+     * @throw std::logic_error if no pidfd is available for the process, see pidfd().
+     * @throw std::system_error in case of errors.
+     */
+    virtual bool has_terminated_or_throw() const;
+
+protected:
+    /**
+     * @brief Wraps an existing process, taking ownership of pidfd, which might be -1.
+     */
+    CORE_POSIX_DLL_LOCAL Process(pid_t pid, int pidfd, long int start_time);
+
 private:
-    struct CORE_POSIX_DLL_LOCAL Private;
-    std::shared_ptr<Private> d;
+    pid_t process_id;
+    long int process_start_time;
 };
 }
 }
@@ -21,8 +21,10 @@
 
 #include <core/posix/signalable.h>
 #include <core/posix/visibility.h>
+#include <core/posix/wait.h>
 
 #include <memory>
+#include <vector>
 
 namespace core
 {
@@ -43,19 +45,88 @@ class Process;
 class CORE_POSIX_DLL_PUBLIC ProcessGroup : public Signalable
 {
 public:
+    /**
+     * @brief The Change struct describes the state change of a member of a process group.
+     */
+    struct Change
+    {
+        pid_t pid; ///< The member that changed state.
+        wait::Result result; ///< The state change of the member.
+    };
+
+    /**
+     * @brief Returns the process group led by leader, without asking the operating system.
+     *
+     * Use for children spawned with Grouping::new_process_group() or
+     * Grouping::new_session(), whose pid is the id of their group.
+     */
+    static ProcessGroup led_by(const Process& leader);
+
     /**
      * @brief Accesses the id of this process group.
      * @return The id of this process group.
      */
     virtual pid_t id() const;
 
+    /**
+     * @brief Waits for any member of the group that is a child of the calling process to change state.
+     *
+     * Terminated members are reaped. ChildProcess instances referring to them
+     * signal via pidfds, and never reach a process that recycled the pid of
+     * a reaped member.
+     *
+     * @throw std::system_error in case of errors, with std::errc::no_child_process if no such member exists.
+     * @param [in] flags Specifies which state changes to wait for.
+     * @return The change, with pid 0 and no_state_change if flags contain wait::Flags::no_hang and no member has changed state.
+     */
+    virtual Change wait_for(const wait::Flags& flags);
+
+    /**
+     * @brief Waits for and reaps all members of the group that are children of the calling process.
+     *
+     * Combined with sending a signal to the group, this takes down a pipeline
+     * or job as a unit. The caveats of wait_for() apply.
+     *
+     * @throw std::system_error in case of errors.
+     * @return The terminations of all members, in order of termination.
+     */
+    virtual std::vector<Change> wait_all();
+
 protected:
     friend class Process;
     CORE_POSIX_DLL_LOCAL ProcessGroup(pid_t id);
 
 private:
-    struct CORE_POSIX_DLL_LOCAL Private;
-    std::shared_ptr<Private> d;
+    pid_t group_id;
+};
+
+/**
+ * @brief The Grouping struct describes the process group and session a newly spawned child is placed in.
+ */
+struct CORE_POSIX_DLL_PUBLIC Grouping
+{
+    /**
+     * @brief Kind enumerates the possible placements.
+     */
+    enum class Kind
+    {
+        inherit, ///< The child stays in the process group and session of its parent.
+        new_process_group, ///< The child leads a new process group.
+        join_process_group, ///< The child joins an existing process group within the session of its parent.
+        new_session ///< The child leads a new session and process group, without a controlling terminal.
+    };
+
+    /** @brief Keeps the child in the process group and session of its parent. */
+    static Grouping inherit();
+    /** @brief Makes the child the leader of a new process group. */
+    static Grouping new_process_group();
+    /** @brief Makes the child join group, e.g., the group of a pipeline's first child. */
+    static Grouping join(const ProcessGroup& group);
+    /** @brief Makes the child the leader of a new session. */
+    static Grouping new_session();
+
+    Kind kind; ///< The placement of the child.
+    pid_t process_group_id; ///< The group to join if kind is Kind::join_process_group.
 };
 }
 }
@@ -0,0 +1,106 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Thomas Voß <thomas.voss@canonical.com>
+ */
+
+#ifndef CORE_POSIX_PROCESS_SET_H_
+#define CORE_POSIX_PROCESS_SET_H_
+
+#include <core/posix/process.h>
+#include <core/posix/signal.h>
+#include <core/posix/visibility.h>
+
+#include <cstddef>
+#include <memory>
+#include <system_error>
+#include <vector>
+
+namespace core
+{
+namespace posix
+{
+/**
+ * @brief The ProcessSet class signals many processes at once, reporting errors per process.
+ *
+ * Whenever possible, a pidfd is obtained for a process when it is added to
+ * the set, and signals are delivered via the pidfd. Signals thus never end up
+ * with an unrelated process that recycled the pid of a member. Processes that
+ * no pidfd can be obtained for, e.g., because the kernel lacks support or
+ * the file descriptor limit has been reached, are signalled via their pid.
+ *
+ * The process set class is implicitly shared. Adding processes and signalling
+ * them must not happen concurrently.
+ */
+class CORE_POSIX_DLL_PUBLIC ProcessSet
+{
+public:
+    /**
+     * @brief Creates an empty set.
+     */
+    ProcessSet();
+
+    /**
+     * @brief Creates a set containing the given processes, in order.
+     */
+    template<typename Processes>
+    explicit ProcessSet(const Processes& processes) : ProcessSet()
+    {
+        for (const auto& process : processes)
+            add(process);
+    }
+
+    /**
+     * @brief Adds process to the set.
+     * @return The index of process in the set, i.e., in the results of signal_all().
+     */
+    std::size_t add(const Process& process);
+
+    /**
+     * @brief Returns the number of processes in the set.
+     */
+    std::size_t size() const;
+
+    /**
+     * @brief Sends signal to all processes in the set.
+     *
+     * Failing to signal a process does not stop the remaining processes from
+     * being signalled.
+     *
+     * @param [in] signal The signal to be sent.
+     * @return One error code per process, in the order the processes have been added.
+     */
+    std::vector<std::error_code> signal_all(Signal signal) const;
+
+    /**
+     * @brief Sends signal to all processes in the set, spreading the work across thread_count threads.
+     *
+     * Only pays off for very large sets. Passing 0 uses as many threads as
+     * there are hardware threads.
+     *
+     * @param [in] signal The signal to be sent.
+     * @param [in] thread_count The number of threads sending signals.
+     * @return One error code per process, in the order the processes have been added.
+     */
+    std::vector<std::error_code> signal_all(Signal signal, std::size_t thread_count) const;
+
+private:
+    struct CORE_POSIX_DLL_LOCAL Private;
+    std::shared_ptr<Private> d;
+};
+}
+}
+
+#endif // CORE_POSIX_PROCESS_SET_H_
@@ -24,7 +24,10 @@
 #include <core/signal.h>
 
 #include <signal.h>
+#include <sys/types.h>
 
+#include <cstddef>
+#include <functional>
 #include <initializer_list>
 #include <memory>
 
@@ -59,12 +62,64 @@ enum class Signal
     sig_ttou = SIGTTOU
 };
 
+/**
+ * @brief Returns the realtime signal SIGRTMIN + n.
+ *
+ * Realtime signals are not enumerated, as their range is determined at
+ * runtime. They can be trapped and sent like any other signal.
+ *
+ * @throw std::out_of_range if SIGRTMIN + n exceeds SIGRTMAX.
+ */
+CORE_POSIX_DLL_PUBLIC Signal realtime_signal(int n);
+
+/**
+ * @brief Returns true if signal is a realtime signal.
+ */
+CORE_POSIX_DLL_PUBLIC bool is_realtime(Signal signal);
+
+/**
+ * @brief The SignalInfo struct carries the details of a raised signal.
+ */
+struct CORE_POSIX_DLL_PUBLIC SignalInfo
+{
+    Signal signal = Signal::unknown; ///< The signal that has been raised.
+    int code = 0; ///< The reason the signal has been raised for, e.g., SI_USER or CLD_EXITED.
+    pid_t sender_pid = 0; ///< The process that sent the signal, or the child that changed state for sig_chld.
+    uid_t sender_uid = 0; ///< The real user id of the sending process.
+    int status = 0; ///< The exit status or signal of the child for sig_chld.
+    int value = 0; ///< The integer payload of signals sent via sigqueue.
+};
+
+/**
+ * @brief A Dispatcher hands a task over to an executor, e.g., a thread pool.
+ */
+typedef std::function<void(const std::function<void()>&)> Dispatcher;
+
+/**
+ * @brief Returns a dispatcher that executes tasks on a pool of thread_count threads.
+ *
+ * The pool lives as long as any copy of the dispatcher. Create the pool after
+ * trapping signals, such that its threads inherit the signal mask.
+ *
+ * @throw std::invalid_argument if thread_count is 0.
+ */
+CORE_POSIX_DLL_PUBLIC Dispatcher thread_pool_dispatcher(std::size_t thread_count);
+
 /**
  * @brief The SignalTrap class encapsulates functionality to trap and handle signals.
  */
 class CORE_POSIX_DLL_PUBLIC SignalTrap
 {
 public:
+    /**
+     * @brief Ordering enumerates the guarantees for signals relayed via a dispatcher.
+     */
+    enum class Ordering
+    {
+        in_order, ///< Occurrences of the signal are relayed one at a time, in order of arrival.
+        unordered ///< Occurrences of the signal might be relayed concurrently.
+    };
+
     SignalTrap(const SignalTrap&) = delete;
     virtual ~SignalTrap() = default;
 
@@ -87,11 +142,50 @@ public:
      */
     virtual void stop() = 0;
 
+    /**
+     * @brief Returns a file descriptor that becomes readable whenever a trapped signal is pending.
+     *
+     * Integrate the descriptor with an existing event loop and call
+     * dispatch_pending() whenever it is readable, instead of dedicating a
+     * thread to run(). Do not read from the descriptor directly.
+     */
+    virtual int native_handle() const = 0;
+
+    /**
+     * @brief Relays all pending signals via signal_raised(), without blocking.
+     * @return The number of signals that have been relayed.
+     * @throw std::system_error in case of errors.
+     */
+    virtual std::size_t dispatch_pending() = 0;
+
     /**
      * @brief Emitted whenever a trapped signal is raised by the operating system.
      */
     virtual core::Signal<Signal>& signal_raised() = 0;
 
+    /**
+     * @brief Emitted whenever a trapped signal is raised by the operating system, right after signal_raised().
+     *
+     * In contrast to signal_raised(), subscribers learn about the sender
+     * and, for sig_chld, about the child that changed state. Note that
+     * standard signals coalesce, so a single sig_chld might be reported for
+     * several children.
+     */
+    virtual core::Signal<SignalInfo>& signal_raised_with_info() = 0;
+
+    /**
+     * @brief Relays occurrences of signal via dispatcher instead of on the thread dispatching the trap.
+     *
+     * Slow subscribers to one signal thus do not delay the relaying of other
+     * signals. Signals without a dispatcher are relayed inline, as before.
+     * Passing an empty dispatcher reverts to inline relaying.
+     *
+     * @param [in] signal The signal to relay via dispatcher.
+     * @param [in] dispatcher Executes the invocations of the subscribers.
+     * @param [in] ordering The guarantees for relaying occurrences of signal.
+     */
+    virtual void dispatch_via(Signal signal, const Dispatcher& dispatcher, Ordering ordering = Ordering::in_order) = 0;
+
 protected:
     SignalTrap() = default;
 };
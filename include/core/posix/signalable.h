@@ -31,6 +31,9 @@ namespace posix
 {
 /**
  * @brief The Signalable class abstracts the ability of an entity to be delivered a posix signal.
+ *
+ * Signalable objects are cheap to copy. Only those owning a pidfd share state
+ * between copies, all others carry nothing but the pid they signal.
  */
 class CORE_POSIX_DLL_PUBLIC Signalable
 {
@@ -49,12 +52,51 @@ public:
      */
     virtual void send_signal(Signal signal, std::error_code& e) noexcept(true);
 
+    /**
+     * @brief Queues a signal carrying an integer payload to this signalable object.
+     *
+     * Realtime signals queue instead of coalescing, which makes them a cheap
+     * notification mechanism. Receivers find the payload in SignalInfo::value.
+     * Process groups cannot be sent queued signals.
+     *
+     * @throws std::system_error in case of problems.
+     * @param [in] signal The signal to be sent to the process.
+     * @param [in] value The payload accompanying the signal.
+     */
+    virtual void send_signal_with_value_or_throw(Signal signal, int value);
+
+    /**
+     * @brief Queues a signal carrying an integer payload to this signalable object.
+     * @param [in] signal The signal to be sent to the process.
+     * @param [in] value The payload accompanying the signal.
+     * @param [out] e Set to contain an error if an issue arises.
+     */
+    virtual void send_signal_with_value(Signal signal, int value, std::error_code& e) noexcept(true);
+
+    /**
+     * @brief Returns the pidfd signals are delivered through, or -1 if signals are delivered via the pid.
+     *
+     * The descriptor remains owned by this signalable object. It becomes
+     * readable once the process it refers to has terminated.
+     */
+    virtual int pidfd() const;
+
 protected:
     CORE_POSIX_DLL_LOCAL explicit Signalable(pid_t pid);
 
+    /**
+     * @brief Delivers signals via pidfd, taking ownership of it.
+     *
+     * In contrast to a pid, a pidfd never refers to a process other than
+     * the one it has been opened for. Passing -1 falls back to the pid.
+     */
+    CORE_POSIX_DLL_LOCAL Signalable(pid_t pid, int pidfd);
+
 private:
     struct CORE_POSIX_DLL_LOCAL Private;
-    std::shared_ptr<Private> d;
+
+    pid_t target; ///< The pid signals are sent to, negative for process groups.
+    std::shared_ptr<Private> d; ///< Owns the pidfd, if any, and is empty otherwise.
 };
 }
 }
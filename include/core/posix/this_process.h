@@ -107,6 +107,31 @@ CORE_POSIX_DLL_PUBLIC Process instance() noexcept(true);
  */
 CORE_POSIX_DLL_PUBLIC Process parent() noexcept(true);
 
+/**
+ * @brief set_child_subreaper_or_throw marks this process as a subreaper, or unmarks it.
+ *
+ * Orphaned descendants of a subreaper are re-parented to it instead of to
+ * init, such that the subreaper can wait for and reap them. Linux only.
+ *
+ * @param [in] enabled true to mark this process as a subreaper.
+ * @throw std::system_error in case of errors.
+ */
+CORE_POSIX_DLL_PUBLIC void set_child_subreaper_or_throw(bool enabled);
+
+/**
+ * @brief set_child_subreaper marks this process as a subreaper, or unmarks it.
+ * @return false in case of errors, true otherwise.
+ * @param [in] enabled true to mark this process as a subreaper.
+ * @param [out] se Receives the details in case of errors.
+ */
+CORE_POSIX_DLL_PUBLIC bool set_child_subreaper(bool enabled, std::error_code& se) noexcept(true);
+
+/**
+ * @brief is_child_subreaper_or_throw checks whether this process is a subreaper.
+ * @throw std::system_error in case of errors.
+ */
+CORE_POSIX_DLL_PUBLIC bool is_child_subreaper_or_throw();
+
 /**
  * @brief Access this process's stdin.
  */
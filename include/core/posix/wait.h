@@ -24,6 +24,7 @@
 #include <core/posix/visibility.h>
 
 #include <bitset>
+#include <chrono>
 
 #include <cstdint>
 
@@ -97,6 +98,18 @@ struct CORE_POSIX_DLL_PUBLIC Result
         } if_stopped;
     } detail;
 };
+
+/**
+ * @brief The ResourceUsage struct summarizes the resources consumed by a terminated child process.
+ */
+struct CORE_POSIX_DLL_PUBLIC ResourceUsage
+{
+    std::chrono::microseconds user_time{0}; ///< CPU time spent in user mode.
+    std::chrono::microseconds system_time{0}; ///< CPU time spent in kernel mode.
+    std::uint64_t max_resident_set_size{0}; ///< Peak resident set size in KiB.
+    std::uint64_t voluntary_context_switches{0}; ///< Number of times the process yielded the CPU.
+    std::uint64_t involuntary_context_switches{0}; ///< Number of times the process was preempted.
+};
 }
 }
 }
@@ -0,0 +1,290 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Thomas Voß <thomas.voss@canonical.com>
+ */
+
+#include <core/posix/async_writer.h>
+
+#include <core/posix/child_process.h>
+#include <core/posix/io_engine.h>
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include <climits>
+
+namespace
+{
+// Upper bound for the number of buffers we coalesce into a single writev.
+const std::size_t max_coalesced_buffers = IOV_MAX;
+
+struct AsyncWriterImpl : public core::posix::AsyncWriter,
+                         public std::enable_shared_from_this<AsyncWriterImpl>
+{
+    AsyncWriterImpl(const std::shared_ptr<core::posix::IoEngine>& engine,
+                    const core::posix::ChildProcess& child,
+                    const core::posix::AsyncWriter::Configuration& configuration)
+        : engine(engine),
+          child(child),
+          fd(child.native_handle(core::posix::StandardStream::stdin)),
+          configuration(configuration)
+    {
+        if (fd == -1)
+            throw std::logic_error(
+                    "AsyncWriter::create_for_stdin: The stdin of the"
+                    " given child process has not been redirected.");
+    }
+
+    bool write(std::string buffer) override
+    {
+        bool kick{false}, changed{false}, result{false};
+
+        {
+            std::lock_guard<std::mutex> lg(guard);
+
+            if (closing)
+                throw std::logic_error("AsyncWriter::write: stdin has been closed.");
+
+            if (failure)
+                throw std::system_error(failure);
+
+            if (!buffer.empty())
+            {
+                queued_bytes += buffer.size();
+                queue.push_back(std::move(buffer));
+
+                if (!in_flight)
+                    in_flight = kick = true;
+
+                if (!backpressured && pending_locked() >= configuration.high_watermark)
+                    backpressured = changed = true;
+            }
+
+            result = !backpressured;
+        }
+
+        if (changed)
+            signals.backpressure_changed(true);
+
+        if (kick)
+        {
+            auto self = shared_from_this();
+            engine->post([self]() { self->write_some(); });
+        }
+
+        return result;
+    }
+
+    std::size_t pending() const override
+    {
+        std::lock_guard<std::mutex> lg(guard);
+        return pending_locked();
+    }
+
+    bool is_backpressured() const override
+    {
+        std::lock_guard<std::mutex> lg(guard);
+        return backpressured;
+    }
+
+    std::future<void> flushed() override
+    {
+        std::lock_guard<std::mutex> lg(guard);
+
+        std::promise<void> promise;
+        auto result = promise.get_future();
+
+        if (failure)
+            promise.set_exception(std::make_exception_ptr(std::system_error(failure)));
+        else if (written_bytes == queued_bytes)
+            promise.set_value();
+        else
+            flush_promises.emplace_back(queued_bytes, std::move(promise));
+
+        return result;
+    }
+
+    void close_stdin() override
+    {
+        bool close_now{false};
+
+        {
+            std::lock_guard<std::mutex> lg(guard);
+
+            if (closing)
+                return;
+
+            closing = true;
+            close_now = !in_flight;
+        }
+
+        if (close_now)
+        {
+            auto self = shared_from_this();
+            engine->post([self]() { self->close(); });
+        }
+    }
+
+    const core::Signal<bool>& backpressure_changed() const override
+    {
+        return signals.backpressure_changed;
+    }
+
+    std::size_t pending_locked() const
+    {
+        return queued_bytes - written_bytes;
+    }
+
+    // Invoked on the engine's thread only.
+    void write_some()
+    {
+        std::vector<::iovec> iov;
+
+        {
+            std::lock_guard<std::mutex> lg(guard);
+
+            // Strings stay in place in the deque, and we only ever pop
+            // from it on the engine's thread, so handing out pointers
+            // to their contents is safe.
+            for (std::size_t i = 0; i < queue.size() && iov.size() < max_coalesced_buffers; i++)
+            {
+                auto skip = i == 0 ? offset : 0;
+                iov.push_back({const_cast<char*>(queue[i].data()) + skip, queue[i].size() - skip});
+            }
+        }
+
+        auto self = shared_from_this();
+        engine->async_write_some(fd, iov.data(), iov.size(), [self](std::size_t size, const std::error_code& e)
+        {
+            self->on_written(size, e);
+        });
+    }
+
+    // Invoked on the engine's thread only.
+    void on_written(std::size_t size, const std::error_code& e)
+    {
+        bool changed{false}, done{false}, close_now{false};
+        std::deque<std::promise<void>> ready;
+
+        {
+            std::lock_guard<std::mutex> lg(guard);
+
+            if (e)
+            {
+                failure = e;
+                queue.clear();
+                offset = 0;
+                written_bytes = queued_bytes;
+                in_flight = false;
+
+                for (auto& pair : flush_promises)
+                    pair.second.set_exception(std::make_exception_ptr(std::system_error(e)));
+                flush_promises.clear();
+
+                changed = backpressured;
+                backpressured = false;
+                close_now = closing;
+                done = true;
+            }
+            else
+            {
+                written_bytes += size;
+
+                offset += size;
+                while (!queue.empty() && offset >= queue.front().size())
+                {
+                    offset -= queue.front().size();
+                    queue.pop_front();
+                }
+
+                while (!flush_promises.empty() && flush_promises.front().first <= written_bytes)
+                {
+                    ready.push_back(std::move(flush_promises.front().second));
+                    flush_promises.pop_front();
+                }
+
+                if (backpressured && pending_locked() < configuration.low_watermark)
+                {
+                    backpressured = false;
+                    changed = true;
+                }
+
+                if (queue.empty())
+                {
+                    in_flight = false;
+                    close_now = closing;
+                    done = true;
+                }
+            }
+        }
+
+        for (auto& promise : ready)
+            promise.set_value();
+
+        if (changed)
+            signals.backpressure_changed(false);
+
+        if (close_now)
+            close();
+        else if (!done)
+            write_some();
+    }
+
+    // Invoked on the engine's thread only.
+    void close()
+    {
+        engine->cancel(fd);
+        child.close_stdin();
+    }
+
+    std::shared_ptr<core::posix::IoEngine> engine;
+    core::posix::ChildProcess child;
+    int fd;
+    core::posix::AsyncWriter::Configuration configuration;
+
+    mutable std::mutex guard;
+    std::deque<std::string> queue;
+    std::size_t offset{0}; // Number of bytes of queue.front() that have been written already.
+    std::uint64_t queued_bytes{0};
+    std::uint64_t written_bytes{0};
+    bool in_flight{false};
+    bool backpressured{false};
+    bool closing{false};
+    std::error_code failure;
+    std::deque<std::pair<std::uint64_t, std::promise<void>>> flush_promises;
+
+    struct
+    {
+        core::Signal<bool> backpressure_changed;
+    } signals;
+};
+}
+
+std::shared_ptr<core::posix::AsyncWriter> core::posix::AsyncWriter::create_for_stdin(
+        const std::shared_ptr<core::posix::IoEngine>& engine,
+        const core::posix::ChildProcess& child)
+{
+    return create_for_stdin(engine, child, Configuration());
+}
+
+std::shared_ptr<core::posix::AsyncWriter> core::posix::AsyncWriter::create_for_stdin(
+        const std::shared_ptr<core::posix::IoEngine>& engine,
+        const core::posix::ChildProcess& child,
+        const core::posix::AsyncWriter::Configuration& configuration)
+{
+    return std::make_shared<AsyncWriterImpl>(engine, child, configuration);
+}
@@ -0,0 +1,305 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Thomas Voß <thomas.voss@canonical.com>
+ */
+
+#include <core/posix/bounded_capture.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace core
+{
+namespace posix
+{
+struct BoundedCapture::Private
+{
+    Private(const BoundedCapture::Configuration& configuration)
+        : configuration(configuration),
+          head(configuration.head_size),
+          ring(configuration.tail_size)
+    {
+    }
+
+    std::size_t head_free() const
+    {
+        return head.size() - head_used;
+    }
+
+    std::size_t ring_free() const
+    {
+        return ring.size() - ring_used;
+    }
+
+    std::size_t ring_write_position() const
+    {
+        return ring.empty() ? 0 : (ring_start + ring_used) % ring.size();
+    }
+
+    // Accounts for size bytes that have been placed into the ring at the
+    // current write position, overwriting the oldest bytes if necessary.
+    void commit_to_ring(std::size_t size)
+    {
+        std::size_t overflow = ring_used + size > ring.size() ? ring_used + size - ring.size() : 0;
+        ring_used = std::min(ring.size(), ring_used + size);
+
+        if (overflow > 0)
+        {
+            ring_start = (ring_start + overflow) % ring.size();
+            dropped += overflow;
+        }
+    }
+
+    void copy_to_ring(const char* data, std::size_t size)
+    {
+        while (size > 0)
+        {
+            auto pos = ring_write_position();
+            auto chunk = std::min(size, ring.size() - pos);
+            std::memcpy(ring.data() + pos, data, chunk);
+            commit_to_ring(chunk);
+            data += chunk; size -= chunk;
+        }
+    }
+
+    // Fills in iovecs pointing directly into the free parts of head and ring.
+    // Under Policy::discard, a full ring is offered for overwriting, starting
+    // at the oldest byte.
+    int prepare(::iovec* iov)
+    {
+        int count = 0;
+
+        if (head_free() > 0)
+            iov[count++] = {head.data() + head_used, head_free()};
+
+        if (ring.empty())
+            return count;
+
+        std::size_t available = configuration.policy == BoundedCapture::Policy::discard
+                ? ring.size()
+                : ring_free();
+
+        auto pos = ring_write_position();
+        auto first = std::min(available, ring.size() - pos);
+
+        if (first > 0)
+            iov[count++] = {ring.data() + pos, first};
+        if (available > first)
+            iov[count++] = {ring.data(), available - first};
+
+        return count;
+    }
+
+    void commit(std::size_t size)
+    {
+        total += size;
+
+        auto h = std::min(size, head_free());
+        head_used += h; size -= h;
+
+        if (ring.empty())
+            dropped += size;
+        else
+            commit_to_ring(size);
+    }
+
+    BoundedCapture::Configuration configuration;
+
+    std::vector<char> head;
+    std::size_t head_used{0};
+
+    std::vector<char> ring;
+    std::size_t ring_start{0};
+    std::size_t ring_used{0};
+
+    std::uint64_t total{0};
+    std::uint64_t dropped{0};
+};
+
+BoundedCapture::BoundedCapture(const BoundedCapture::Configuration& configuration)
+    : d(new Private{configuration})
+{
+}
+
+BoundedCapture::~BoundedCapture()
+{
+}
+
+const BoundedCapture::Configuration& BoundedCapture::configuration() const
+{
+    return d->configuration;
+}
+
+std::size_t BoundedCapture::write(const char* data, std::size_t size)
+{
+    auto h = std::min(size, d->head_free());
+    std::memcpy(d->head.data() + d->head_used, data, h);
+    d->head_used += h;
+    d->total += h;
+
+    data += h;
+    auto remaining = size - h;
+
+    switch (d->configuration.policy)
+    {
+    case Policy::backpressure:
+    {
+        auto n = std::min(remaining, d->ring_free());
+        d->copy_to_ring(data, n);
+        d->total += n;
+        return h + n;
+    }
+    case Policy::discard:
+    {
+        d->total += remaining;
+
+        // Only the last ring.size() bytes can possibly survive.
+        if (remaining > d->ring.size())
+        {
+            d->dropped += remaining - d->ring.size();
+            data += remaining - d->ring.size();
+            remaining = d->ring.size();
+        }
+
+        d->copy_to_ring(data, remaining);
+        return size;
+    }
+    }
+
+    return h;
+}
+
+std::size_t BoundedCapture::read_some_from(int fd, std::error_code& e) noexcept(true)
+{
+    ::iovec iov[3];
+    int count = d->prepare(iov);
+
+    // With a zero-sized ring, we still have to drain the fd under Policy::discard.
+    char scratch[4096];
+    if (count == 0)
+    {
+        if (d->configuration.policy == Policy::backpressure)
+            return 0;
+
+        iov[count++] = {scratch, sizeof(scratch)};
+    }
+
+    ssize_t rc = -1;
+    do
+    {
+        rc = ::readv(fd, iov, count);
+    } while (rc == -1 && errno == EINTR);
+
+    if (rc == -1)
+    {
+        e = std::error_code(errno, std::system_category());
+        return 0;
+    }
+
+    d->commit(static_cast<std::size_t>(rc));
+    return static_cast<std::size_t>(rc);
+}
+
+std::size_t BoundedCapture::read_some_from_or_throw(int fd)
+{
+    std::error_code e;
+    auto result = read_some_from(fd, e);
+
+    if (e)
+        throw std::system_error(e);
+
+    return result;
+}
+
+std::uint64_t BoundedCapture::read_all_from(int fd, std::error_code& e) noexcept(true)
+{
+    std::uint64_t result{0};
+
+    while (true)
+    {
+        auto n = read_some_from(fd, e);
+        result += n;
+
+        if (e || n == 0)
+            break;
+    }
+
+    return result;
+}
+
+std::uint64_t BoundedCapture::read_all_from_or_throw(int fd)
+{
+    std::error_code e;
+    auto result = read_all_from(fd, e);
+
+    if (e)
+        throw std::system_error(e);
+
+    return result;
+}
+
+bool BoundedCapture::is_full() const
+{
+    return d->configuration.policy == Policy::backpressure &&
+            d->head_free() == 0 &&
+            d->ring_free() == 0;
+}
+
+std::string BoundedCapture::head() const
+{
+    return std::string(d->head.data(), d->head_used);
+}
+
+std::string BoundedCapture::tail() const
+{
+    std::string result; result.reserve(d->ring_used);
+
+    auto first = std::min(d->ring_used, d->ring.size() - d->ring_start);
+    result.append(d->ring.data() + d->ring_start, first);
+    result.append(d->ring.data(), d->ring_used - first);
+
+    return result;
+}
+
+std::uint64_t BoundedCapture::total() const
+{
+    return d->total;
+}
+
+std::uint64_t BoundedCapture::dropped() const
+{
+    return d->dropped;
+}
+
+bool BoundedCapture::is_truncated() const
+{
+    return d->dropped > 0;
+}
+
+void BoundedCapture::reset()
+{
+    d->head_used = 0;
+    d->ring_start = 0;
+    d->ring_used = 0;
+    d->total = 0;
+    d->dropped = 0;
+}
+}
+}
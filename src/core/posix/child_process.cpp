@@ -17,135 +17,1098 @@
  */
 
 #include <core/posix/child_process.h>
+#include <core/posix/this_process.h>
+#include <core/posix/linux/proc/process/stat.h>
+
+#include "known_children.h"
+#include "linux/pidfd.h"
+#include "wait_support.h"
 
 #include <boost/iostreams/device/file_descriptor.hpp>
 #include <boost/iostreams/stream.hpp>
 
-#include <atomic>
-#include <fstream>
-#include <mutex>
-#include <unordered_map>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+
+namespace io = boost::iostreams;
+
+namespace
+{
+core::posix::wait::ResourceUsage resource_usage_from_rusage(const ::rusage& usage)
+{
+    core::posix::wait::ResourceUsage result;
+
+    result.user_time = std::chrono::seconds{usage.ru_utime.tv_sec} + std::chrono::microseconds{usage.ru_utime.tv_usec};
+    result.system_time = std::chrono::seconds{usage.ru_stime.tv_sec} + std::chrono::microseconds{usage.ru_stime.tv_usec};
+    result.max_resident_set_size = usage.ru_maxrss;
+    result.voluntary_context_switches = usage.ru_nvcsw;
+    result.involuntary_context_switches = usage.ru_nivcsw;
+
+    return result;
+}
+
+// Receives the exits of the children it has registered with the Reaper.
+struct ReaperClient
+{
+    virtual ~ReaperClient() = default;
+
+    // Invoked by the reaper once the pidfd of child pid has become readable.
+    virtual void on_pidfd_ready(pid_t pid) = 0;
+};
+
+// The Reaper watches the pidfds of the children of all DeathObserver instances
+// and of the ExitWatcher with a single epoll instance. Readiness is dispatched
+// to the client that registered the pidfd, which then reaps the child and
+// bookkeeps on its own. Clients thus share neither a map nor a mutex for their
+// children.
+class Reaper
+{
+public:
+    typedef std::uint32_t ClientId;
+
+    // Returns the process-wide instance, creating it if necessary. The
+    // instance lives as long as any client holds on to it.
+    static std::shared_ptr<Reaper> instance()
+    {
+        static std::mutex guard;
+        static std::weak_ptr<Reaper> instance;
+
+        std::lock_guard<std::mutex> lg(guard);
+
+        // A forked child must not share the epoll instance of its parent.
+        auto result = instance.lock();
+        if (!result || result->forked())
+        {
+            result.reset(new Reaper());
+            instance = result;
+        }
+
+        return result;
+    }
+
+    ~Reaper()
+    {
+        ::close(epoll_fd);
+    }
+
+    ClientId add_client(const std::shared_ptr<ReaperClient>& client)
+    {
+        std::lock_guard<std::mutex> lg(guard);
+
+        auto id = next_client_id++;
+        clients[id] = client;
+
+        return id;
+    }
+
+    void remove_client(ClientId id)
+    {
+        std::lock_guard<std::mutex> lg(guard);
+        clients.erase(id);
+    }
+
+    // Starts watching pidfd on behalf of client. Returns false if pidfd cannot be watched.
+    bool watch(ClientId client, pid_t pid, int pidfd)
+    {
+        if (forked())
+            return false;
+
+        ::epoll_event ev; ev.events = EPOLLIN | EPOLLONESHOT; ev.data.u64 = key(client, pid);
+        return ::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, pidfd, &ev) == 0;
+    }
+
+    // Re-enables a watch after readiness has been dispatched without the child being reaped.
+    void rewatch(ClientId client, pid_t pid, int pidfd)
+    {
+        if (forked())
+            return;
+
+        ::epoll_event ev; ev.events = EPOLLIN | EPOLLONESHOT; ev.data.u64 = key(client, pid);
+        ::epoll_ctl(epoll_fd, EPOLL_CTL_MOD, pidfd, &ev);
+    }
+
+    void unwatch(int pidfd)
+    {
+        if (forked())
+            return;
+
+        ::epoll_ctl(epoll_fd, EPOLL_CTL_DEL, pidfd, nullptr);
+    }
+
+    // Dispatches all pidfds that have become readable to their clients. Watches
+    // are one-shot, so every exit is dispatched exactly once, even if multiple
+    // threads dispatch concurrently.
+    void dispatch()
+    {
+        for (auto key : collect(nullptr))
+            deliver(key);
+    }
+
+    // Blocks until a watched pidfd has become readable, and dispatches the
+    // readable pidfds of client. The ones of other clients are deferred to
+    // the next dispatch(), which the SIGCHLD of their exits triggers, such
+    // that clients are not called back on threads they do not expect.
+    // Returns false with errno set if waiting fails.
+    bool wait_and_dispatch(ClientId client)
+    {
+        ::pollfd pfd{epoll_fd, POLLIN, 0};
+        if (::poll(&pfd, 1, -1) == -1 && errno != EINTR)
+            return false;
+
+        for (auto key : collect(&client))
+            deliver(key);
+
+        return true;
+    }
+
+private:
+    Reaper() : epoll_fd(::epoll_create1(EPOLL_CLOEXEC)), owner(::getpid())
+    {
+        if (epoll_fd == -1)
+            throw std::system_error(errno, std::system_category());
+    }
+
+    // A forked child shares the epoll instance with its parent, and must not
+    // touch the parent's watches, e.g., when tearing down observers on exit.
+    bool forked() const
+    {
+        return ::getpid() != owner;
+    }
+
+    static std::uint64_t key(ClientId client, pid_t pid)
+    {
+        return (static_cast<std::uint64_t>(client) << 32) | static_cast<std::uint32_t>(pid);
+    }
+
+    // Harvests the keys of readable pidfds. Without client, keys deferred
+    // before are included. Otherwise, only the keys of client are returned,
+    // and the others deferred. Harvesting is serialized, so dispatch() either
+    // sees a readable pidfd or its deferred key.
+    std::vector<std::uint64_t> collect(const ClientId* client)
+    {
+        static constexpr int max_events = 64;
+        ::epoll_event events[max_events];
+
+        std::vector<std::uint64_t> result;
+        std::lock_guard<std::mutex> lg(harvest_guard);
+
+        if (!client)
+            result.swap(deferred);
+
+        int rc{0};
+        do
+        {
+            rc = ::epoll_wait(epoll_fd, events, max_events, 0);
+
+            for (int i = 0; i < rc; i++)
+            {
+                if (!client || static_cast<ClientId>(events[i].data.u64 >> 32) == *client)
+                    result.push_back(events[i].data.u64);
+                else
+                    deferred.push_back(events[i].data.u64);
+            }
+        } while (rc == max_events || (rc == -1 && errno == EINTR));
+
+        return result;
+    }
+
+    void deliver(std::uint64_t key)
+    {
+        auto client = client_for(static_cast<ClientId>(key >> 32));
+        if (client)
+            client->on_pidfd_ready(static_cast<pid_t>(key & 0xffffffff));
+    }
+
+    std::shared_ptr<ReaperClient> client_for(ClientId id)
+    {
+        std::lock_guard<std::mutex> lg(guard);
+
+        auto it = clients.find(id);
+        return it == clients.end() ? std::shared_ptr<ReaperClient>{} : it->second.lock();
+    }
+
+    int epoll_fd;
+    pid_t owner;
+    std::mutex guard;
+    std::mutex harvest_guard;
+    std::vector<std::uint64_t> deferred;
+    ClientId next_client_id{0};
+    std::unordered_map<ClientId, std::weak_ptr<ReaperClient>> clients;
+};
+
+// Returns the pids of all children of this process, including zombies.
+std::vector<pid_t> children_of_this_process()
+{
+    std::vector<pid_t> result;
+
+    // Children are accounted to the thread that forked them.
+    if (auto dir = ::opendir("/proc/self/task"))
+    {
+        bool supported{false};
+
+        while (auto entry = ::readdir(dir))
+        {
+            if (entry->d_name[0] == '.')
+                continue;
+
+            std::ifstream in(std::string{"/proc/self/task/"} + entry->d_name + "/children");
+            supported = supported || in.is_open();
+
+            pid_t pid{-1};
+            while (in >> pid)
+                result.push_back(pid);
+        }
+
+        ::closedir(dir);
+
+        if (supported)
+            return result;
+    }
+
+    // The kernel has been built without CONFIG_PROC_CHILDREN, we have to scan all processes.
+    if (auto dir = ::opendir("/proc"))
+    {
+        const pid_t self = ::getpid();
+
+        while (auto entry = ::readdir(dir))
+        {
+            pid_t pid = static_cast<pid_t>(std::strtol(entry->d_name, nullptr, 10));
+            if (pid <= 0)
+                continue;
+
+            try
+            {
+                core::posix::linux::proc::process::Stat stat;
+                core::posix::Process{pid} >> stat;
+
+                if (stat.parent == self)
+                    result.push_back(pid);
+            } catch(...)
+            {
+                // The process has vanished in the meantime.
+            }
+        }
+
+        ::closedir(dir);
+    }
+
+    return result;
+}
+
+// The state of an observer, shared with the reaper while it dispatches to us.
+//
+// Children are distributed across shards by pid, each shard guarded by its
+// own mutex, such that threads adding children rarely contend with each other
+// or with the thread reaping them. child_died is never emitted with a shard
+// locked: Deaths are collected while holding the lock and announced once it
+// has been released, so slow subscribers do not hold up add().
+struct DeathObserverState : public ReaperClient
+{
+    struct Child
+    {
+        core::posix::ChildProcess process;
+        int pidfd;
+    };
+
+    struct Shard
+    {
+        std::mutex guard;
+        std::unordered_map<pid_t, Child> children;
+    };
+
+    typedef core::posix::ChildProcess::DeathObserver::Exit Exit;
+    typedef std::vector<std::pair<core::posix::ChildProcess, Exit>> Deaths;
+
+    static constexpr std::size_t shard_count = 16;
+
+    DeathObserverState() : reaper(Reaper::instance())
+    {
+    }
+
+    ~DeathObserverState()
+    {
+        for (auto& shard : shards)
+        {
+            for (const auto& pair : shard.children)
+            {
+                if (pair.second.pidfd != -1)
+                {
+                    reaper->unwatch(pair.second.pidfd);
+                    ::close(pair.second.pidfd);
+                }
+            }
+        }
+    }
+
+    Shard& shard_for(pid_t pid)
+    {
+        return shards[static_cast<std::size_t>(pid) % shard_count];
+    }
+
+    bool add(const core::posix::ChildProcess& process)
+    {
+        auto& shard = shard_for(process.pid());
+
+        // Opening the pidfd and checking on the child do not need the lock.
+        Child child{process, impl::pidfd_dup_or_open(process.pidfd(), process.pid())};
+
+        // The process has been reaped by somebody else already.
+        if (child.pidfd == -1 && errno == ESRCH)
+        {
+            if (!has(process))
+                announce(Deaths{std::make_pair(process, unknown_exit(process.pid()))});
+
+            return false;
+        }
+
+        Exit exit;
+
+        {
+            std::unique_lock<std::mutex> ul(shard.guard);
+
+            if (shard.children.count(process.pid()) > 0)
+            {
+                ul.unlock();
+
+                if (child.pidfd != -1)
+                    ::close(child.pidfd);
+
+                return false;
+            }
+
+            // Start watching before checking on the child. A death racing
+            // with the check would otherwise be signalled before we watch,
+            // and never be noticed.
+            if (child.pidfd != -1 && !reaper->watch(id, process.pid(), child.pidfd))
+            {
+                ::close(child.pidfd);
+                child.pidfd = -1;
+            }
+
+            if (child.pidfd == -1)
+                children_without_pidfd++;
+
+            // The process may have died between it's instantiation and it
+            // being added to the children map. Check that it's still alive.
+            // We need to do so while holding the lock, such that a concurrent
+            // add() of the same child does not report its death twice.
+            if (!try_reap(child, exit))
+            {
+                shard.children.insert(std::make_pair(process.pid(), child));
+                return true;
+            }
+
+            if (child.pidfd != -1)
+                reaper->unwatch(child.pidfd);
+            else
+                children_without_pidfd--;
+        }
+
+        // we missed the SIGCHLD signal so we must now manually
+        // inform our subscribers.
+        announce(Deaths{std::make_pair(process, exit)});
+
+        if (child.pidfd != -1)
+            ::close(child.pidfd);
+
+        return false;
+    }
+
+    bool has(const core::posix::ChildProcess& process)
+    {
+        auto& shard = shard_for(process.pid());
+
+        std::lock_guard<std::mutex> lg(shard.guard);
+        return shard.children.count(process.pid()) > 0;
+    }
+
+    void on_pidfd_ready(pid_t pid) override
+    {
+        Deaths deaths;
+
+        {
+            auto& shard = shard_for(pid);
+            std::lock_guard<std::mutex> lg(shard.guard);
+
+            auto it = shard.children.find(pid);
+            if (it == shard.children.end())
+                return;
+
+            Exit exit;
+            if (try_reap(it->second, exit))
+                died(shard, it, exit, deaths);
+            else
+                reaper->rewatch(id, pid, it->second.pidfd);
+        }
+
+        announce(deaths);
+    }
+
+    // Children we could not obtain a pidfd for are checked one by one.
+    void reap_children_without_pidfd()
+    {
+        if (children_without_pidfd.load() == 0)
+            return;
+
+        Deaths deaths;
+
+        for (auto& shard : shards)
+        {
+            std::lock_guard<std::mutex> lg(shard.guard);
+
+            for (auto it = shard.children.begin(); it != shard.children.end();)
+            {
+                auto current = it++;
+
+                Exit exit;
+                if (current->second.pidfd == -1 && try_reap(current->second, exit))
+                    died(shard, current, exit, deaths);
+            }
+        }
+
+        announce(deaths);
+    }
+
+    // Reaps child if it has terminated. Returns true if the child has been
+    // reaped, either by us or by somebody else, and describes its exit.
+    static bool try_reap(const Child& child, Exit& exit)
+    {
+        ::rusage usage;
+        ::memset(&usage, 0, sizeof(usage));
+
+        exit = unknown_exit(child.process.pid());
+
+        if (child.pidfd != -1)
+        {
+            ::siginfo_t info;
+            if (impl::pidfd_try_reap(child.pidfd, info, usage) == -1)
+                return errno == ECHILD;
+
+            if (info.si_pid == 0)
+                return false;
+
+            exit.result = impl::result_from_siginfo(info);
+        } else
+        {
+            int status{-1};
+            auto rc = ::wait4(child.process.pid(), &status, WNOHANG, &usage);
+
+            if (rc == 0)
+                return false;
+
+            if (rc == -1)
+                return true;
+
+            exit.result = impl::result_from_status(status);
+        }
+
+        exit.usage = resource_usage_from_rusage(usage);
+        return true;
+    }
+
+    static Exit unknown_exit(pid_t pid)
+    {
+        Exit exit;
+        exit.pid = pid;
+        exit.reaped_at = std::chrono::system_clock::now();
+
+        return exit;
+    }
+
+    // Removes the child it refers to from shard, recording its death.
+    void died(Shard& shard, std::unordered_map<pid_t, Child>::iterator it, const Exit& exit, Deaths& deaths)
+    {
+        deaths.push_back(std::make_pair(it->second.process, exit));
+
+        if (it->second.pidfd != -1)
+        {
+            reaper->unwatch(it->second.pidfd);
+            ::close(it->second.pidfd);
+        }
+        else
+        {
+            children_without_pidfd--;
+        }
+
+        shard.children.erase(it);
+    }
+
+    void announce(const Deaths& deaths)
+    {
+        if (deaths.empty())
+            return;
+
+        {
+            std::lock_guard<std::mutex> lg(history.guard);
+
+            for (const auto& death : deaths)
+            {
+                history.exits.push_back(death.second);
+
+                if (history.exits.size() > history.size)
+                    history.exits.pop_front();
+            }
+        }
+
+        for (const auto& death : deaths)
+        {
+            signals.child_died(death.first);
+            signals.child_exited(death.second);
+        }
+    }
+
+    std::shared_ptr<Reaper> reaper;
+    Reaper::ClientId id{0};
+
+    // Kills adopted orphans if requested, and reaps and reports the ones that have terminated.
+    void handle_orphans()
+    {
+        auto policy = orphan_policy.load();
+
+        if (policy == core::posix::ChildProcess::DeathObserver::OrphanPolicy::ignore)
+            return;
+
+        for (auto pid : children_of_this_process())
+        {
+            if (!impl::KnownChildren::instance().is_orphan(pid))
+                continue;
+
+            if (policy == core::posix::ChildProcess::DeathObserver::OrphanPolicy::kill_and_reap)
+                ::kill(pid, SIGKILL);
+
+            int status{-1};
+            ::rusage usage;
+            ::memset(&usage, 0, sizeof(usage));
+
+            // Multiple observers might race for the orphan, only the winner reports it.
+            if (::wait4(pid, &status, WNOHANG, &usage) != pid)
+                continue;
+
+            auto exit = unknown_exit(pid);
+            exit.result = impl::result_from_status(status);
+            exit.usage = resource_usage_from_rusage(usage);
+
+            signals.orphan_died(exit);
+        }
+    }
+
+    std::array<Shard, shard_count> shards;
+    std::atomic<std::size_t> children_without_pidfd{0};
+    std::atomic<core::posix::ChildProcess::DeathObserver::OrphanPolicy> orphan_policy
+    {
+        core::posix::ChildProcess::DeathObserver::OrphanPolicy::ignore
+    };
+
+    struct
+    {
+        mutable std::mutex guard;
+        std::size_t size{core::posix::ChildProcess::DeathObserver::default_exit_history_size};
+        std::deque<Exit> exits;
+    } history;
+
+    struct
+    {
+        core::Signal<core::posix::ChildProcess> child_died;
+        core::Signal<Exit> child_exited;
+        core::Signal<Exit> orphan_died;
+    } signals;
+};
+
+struct DeathObserverImpl : public core::posix::ChildProcess::DeathObserver
+{
+    DeathObserverImpl(const std::shared_ptr<core::posix::SignalTrap>& trap)
+        : state(std::make_shared<DeathObserverState>()),
+          on_sig_child_connection
+          {
+              trap->signal_raised().connect([this](core::posix::Signal signal)
+              {
+                  switch (signal)
+                  {
+                  case core::posix::Signal::sig_chld:
+                    on_sig_child();
+                    break;
+                  default:
+                    break;
+                  }
+              })
+          }
+    {
+        if (!trap->has(core::posix::Signal::sig_chld))
+            throw std::logic_error(
+                    "DeathObserver::DeathObserverImpl: Given SignalTrap"
+                    " instance does not trap Signal::sig_chld.");
+
+        state->id = state->reaper->add_client(state);
+    }
+
+    ~DeathObserverImpl()
+    {
+        state->reaper->remove_client(state->id);
+    }
+
+    bool add(const core::posix::ChildProcess& process) override
+    {
+        if (process.pid() == -1)
+            return false;
+
+        return state->add(process);
+    }
+
+    bool has(const core::posix::ChildProcess& process) const override
+    {
+        return state->has(process);
+    }
+
+    const core::Signal<core::posix::ChildProcess>& child_died() const override
+    {
+        return state->signals.child_died;
+    }
+
+    const core::Signal<Exit>& child_exited() const override
+    {
+        return state->signals.child_exited;
+    }
+
+    std::vector<Exit> exit_history() const override
+    {
+        std::lock_guard<std::mutex> lg(state->history.guard);
+        return std::vector<Exit>(state->history.exits.begin(), state->history.exits.end());
+    }
+
+    void set_exit_history_size(std::size_t size) override
+    {
+        std::lock_guard<std::mutex> lg(state->history.guard);
+
+        state->history.size = size;
+        while (state->history.exits.size() > size)
+            state->history.exits.pop_front();
+    }
+
+    void on_sig_child() override
+    {
+        // Signals coalesce, and a single SIGCHLD might be all that is
+        // delivered for the exits of children of several observers. We
+        // thus dispatch all exits, not only our own.
+        state->reaper->dispatch();
+        state->reap_children_without_pidfd();
+        state->handle_orphans();
+    }
+
+    void set_orphan_policy(OrphanPolicy policy) override
+    {
+        if (policy != OrphanPolicy::ignore)
+            core::posix::this_process::set_child_subreaper_or_throw(true);
+
+        state->orphan_policy = policy;
+
+        // Orphans might have been adopted already.
+        state->handle_orphans();
+    }
+
+    const core::Signal<Exit>& orphan_died() const override
+    {
+        return state->signals.orphan_died;
+    }
+
+    std::shared_ptr<DeathObserverState> state;
+    core::ScopedConnection on_sig_child_connection;
+};
+
+// Resolves the exit futures of children, and reaps children whose last
+// ChildProcess instance is gone. The watcher is a client of the Reaper, and
+// a thread owned by the library waits on the reaper's epoll instance, such
+// that in-flight children do not cost a thread each.
+class ExitWatcher : public ReaperClient
+{
+public:
+    // Returns the instance for the calling process. Instances are never
+    // destroyed, as the thread reaps children until the process exits. A
+    // forked child does not inherit the thread, and gets its own instance.
+    static ExitWatcher& instance()
+    {
+        static std::mutex guard;
+        static std::shared_ptr<ExitWatcher>* instance{nullptr};
+
+        std::lock_guard<std::mutex> lg(guard);
+
+        if (!instance || (*instance)->owner != ::getpid())
+        {
+            instance = new std::shared_ptr<ExitWatcher>(new ExitWatcher());
+
+            auto watcher = instance->get();
+            watcher->id = watcher->reaper->add_client(*instance);
+            std::thread{[watcher]() { watcher->run(); }}.detach();
+        }
+
+        return **instance;
+    }
+
+    // Watches the child referred to by pidfd, or by pid if pidfd is -1.
+    std::shared_future<core::posix::wait::Result> watch(pid_t pid, int pidfd)
+    {
+        std::lock_guard<std::mutex> lg(guard);
+
+        if (failure)
+            throw std::system_error(failure);
+
+        auto it = pending.find(pid);
+        if (it != pending.end())
+            return it->second.future;
+
+        std::promise<core::posix::wait::Result> promise;
+        auto future = promise.get_future().share();
+
+        pidfd = impl::pidfd_dup_or_open(pidfd, pid);
+
+        if (pidfd == -1)
+        {
+            // The child has been reaped by somebody else already.
+            if (errno == ESRCH)
+            {
+                promise.set_value(core::posix::wait::Result{});
+                return future;
+            }
+
+            throw std::system_error(errno, std::system_category());
+        }
+
+        // The child is pending before its pidfd is watched, so readiness
+        // dispatched to us right away finds it.
+        pending.insert(std::make_pair(pid, Pending{pidfd, std::move(promise), future}));
+
+        if (!reaper->watch(id, pid, pidfd))
+        {
+            std::error_code ec(errno, std::system_category());
+            pending.erase(pid);
+            ::close(pidfd);
+            throw std::system_error(ec);
+        }
+
+        return future;
+    }
+
+    void on_pidfd_ready(pid_t pid) override
+    {
+        Pending reaped;
+        core::posix::wait::Result result;
+
+        {
+            std::lock_guard<std::mutex> lg(guard);
+
+            auto it = pending.find(pid);
+            if (it == pending.end())
+                return;
+
+            ::siginfo_t info;
+            ::rusage usage;
+
+            if (impl::pidfd_try_reap(it->second.pidfd, info, usage) == 0)
+            {
+                if (info.si_pid == 0)
+                {
+                    reaper->rewatch(id, pid, it->second.pidfd);
+                    return;
+                }
+
+                result = impl::result_from_siginfo(info);
+            }
 
-#include <fcntl.h>
-#include <poll.h>
-#include <unistd.h>
+            reaped = std::move(it->second);
+            pending.erase(it);
+        }
 
-#include <sys/eventfd.h>
-#include <sys/signalfd.h>
+        reaper->unwatch(reaped.pidfd);
+        ::close(reaped.pidfd);
 
-namespace io = boost::iostreams;
+        impl::KnownChildren::instance().forget(pid);
+        reaped.promise.set_value(result);
+    }
 
-namespace
-{
+private:
+    struct Pending
+    {
+        int pidfd;
+        std::promise<core::posix::wait::Result> promise;
+        std::shared_future<core::posix::wait::Result> future;
+    };
 
-struct DeathObserverImpl : public core::posix::ChildProcess::DeathObserver
-{
-    DeathObserverImpl(const std::shared_ptr<core::posix::SignalTrap>& trap)
-        : on_sig_child_connection
-          {
-              trap->signal_raised().connect([this](core::posix::Signal signal)
-              {
-                  switch (signal)
-                  {
-                  case core::posix::Signal::sig_chld:
-                    on_sig_child();
-                    break;
-                  default:
-                    break;
-                  }
-              })
-          }
+    ExitWatcher() : owner(::getpid()), reaper(Reaper::instance())
     {
-        if (!trap->has(core::posix::Signal::sig_chld))
-            throw std::logic_error(
-                    "DeathObserver::DeathObserverImpl: Given SignalTrap"
-                    " instance does not trap Signal::sig_chld.");
     }
 
-    bool add(const core::posix::ChildProcess& process) override
+    void run()
     {
-        if (process.pid() == -1)
-            return false;
-
-        std::lock_guard<std::mutex> lg(guard);
+        while (reaper->wait_and_dispatch(id));
 
-        bool added = false;
-        auto new_process = std::make_pair(process.pid(), process);
-        std::tie(std::ignore, added) = children.insert(new_process);
+        // Waiting only fails for reasons we cannot recover from. Instead of
+        // spinning, we fail all pending futures and refuse to watch more.
+        std::error_code ec(errno, std::system_category());
+        std::unordered_map<pid_t, Pending> failed;
 
-        if (added)
         {
-            // The process may have died between it's instantiation and it
-            // being added to the children map. Check that it's still alive.
-            int status{-1};
-            if (::waitpid(process.pid(), &status, WNOHANG) != 0) // child no longer alive
-            {
-                // we missed the SIGCHLD signal so we must now manually
-                // inform our subscribers.
-                signals.child_died(new_process.second);
-                children.erase(new_process.first);
-                return false;
-            }
+            std::lock_guard<std::mutex> lg(guard);
+
+            failure = ec;
+            failed.swap(pending);
         }
 
-        return added;
+        for (auto& pair : failed)
+        {
+            reaper->unwatch(pair.second.pidfd);
+            ::close(pair.second.pidfd);
+            pair.second.promise.set_exception(std::make_exception_ptr(std::system_error(ec)));
+        }
     }
 
-    bool has(const core::posix::ChildProcess& process) const override
+    pid_t owner;
+    std::shared_ptr<Reaper> reaper;
+    Reaper::ClientId id{0};
+    std::mutex guard;
+    std::error_code failure;
+    std::unordered_map<pid_t, Pending> pending;
+};
+
+// Reaps the children in a set as they terminate, until either any or all of
+// them have terminated, or the deadline has passed.
+std::vector<core::posix::wait::Change> wait_for_set(
+        const std::vector<core::posix::ChildProcess>& children,
+        bool all,
+        const std::chrono::steady_clock::time_point& deadline)
+{
+    // Children without a pidfd are checked on in slices.
+    static const std::chrono::milliseconds slice{10};
+
+    std::vector<core::posix::wait::Change> changes;
+
+    if (children.empty())
+        return changes;
+
+    int epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd == -1)
+        throw std::system_error(errno, std::system_category());
+
+    std::vector<int> pidfds(children.size(), -1);
+    std::vector<bool> terminated(children.size(), false);
+    std::size_t remaining{children.size()}, without_pidfd{0};
+
+    auto cleanup = [&]()
     {
-        std::lock_guard<std::mutex> lg(guard);
-        return children.count(process.pid()) > 0;
-    }
+        for (auto pidfd : pidfds)
+            if (pidfd != -1)
+                ::close(pidfd);
 
-    const core::Signal<core::posix::ChildProcess>& child_died() const override
+        ::close(epoll_fd);
+    };
+
+    auto finish = [&](std::size_t i, const core::posix::wait::Result& result)
     {
-        return signals.child_died;
+        changes.push_back(core::posix::wait::Change{i, result});
+        terminated[i] = true;
+        remaining--;
+
+        if (pidfds[i] == -1)
+        {
+            without_pidfd--;
+            return;
+        }
+
+        ::close(pidfds[i]);
+        pidfds[i] = -1;
+    };
+
+    for (std::size_t i = 0; i < children.size(); i++)
+    {
+        pidfds[i] = impl::pidfd_dup_or_open(children[i].pidfd(), children[i].pid());
+
+        if (pidfds[i] == -1)
+        {
+            without_pidfd++;
+
+            // The child has been reaped by somebody else already.
+            if (errno == ESRCH)
+                finish(i, core::posix::wait::Result{});
+
+            continue;
+        }
+
+        ::epoll_event ev; ev.events = EPOLLIN; ev.data.u64 = i;
+        if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, pidfds[i], &ev) == -1)
+        {
+            std::error_code ec(errno, std::system_category());
+            cleanup();
+            throw std::system_error(ec);
+        }
     }
 
-    void on_sig_child() override
+    std::vector<::epoll_event> events(std::min<std::size_t>(children.size(), 256));
+
+    while (remaining > 0 && (all || changes.empty()))
     {
-        pid_t pid{-1}; int status{-1};
-        while (true)
+        for (std::size_t i = 0; without_pidfd > 0 && i < children.size(); i++)
         {
-            pid = ::waitpid(0, &status, WNOHANG);
+            if (terminated[i] || pidfds[i] != -1)
+                continue;
 
-            if (pid == -1)
-            {
-                if (errno == ECHILD)
-                {
-                    break; // No more children
-                }
-                continue; // Ignore stray SIGCHLD signals
-            }
-            else if (pid == 0)
-            {
-                break; // No more children
-            }
-            else
-            {
-                std::lock_guard<std::mutex> lg(guard);
-                auto it = children.find(pid);
+            ::siginfo_t info; info.si_pid = 0;
+            if (::waitid(P_PID, children[i].pid(), &info, WEXITED | WNOHANG) == -1)
+                finish(i, core::posix::wait::Result{});
+            else if (info.si_pid != 0)
+                finish(i, impl::result_from_siginfo(info));
+        }
 
-                if (it != children.end())
-                {
-                    if (WIFSIGNALED(status) || WIFEXITED(status))
-                    {
-                        signals.child_died(it->second);
-                        children.erase(it);
-                    }
-                }
-            }
+        if (remaining == 0 || (!all && !changes.empty()))
+            break;
+
+        int timeout{-1};
+        if (deadline != std::chrono::steady_clock::time_point::max())
+        {
+            auto now = std::chrono::steady_clock::now();
+            if (now >= deadline)
+                break;
+
+            // Round up, we would spin until the deadline otherwise.
+            timeout = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        deadline - now + std::chrono::milliseconds{1} - std::chrono::nanoseconds{1}).count();
+        }
+
+        if (without_pidfd > 0 && (timeout == -1 || timeout > slice.count()))
+            timeout = slice.count();
+
+        int rc = ::epoll_wait(epoll_fd, events.data(), events.size(), timeout);
+
+        if (rc == -1 && errno != EINTR)
+        {
+            std::error_code ec(errno, std::system_category());
+            cleanup();
+            throw std::system_error(ec);
+        }
+
+        for (int i = 0; i < rc; i++)
+        {
+            auto index = static_cast<std::size_t>(events[i].data.u64);
+
+            if (terminated[index])
+                continue;
+
+            ::siginfo_t info; ::rusage usage;
+            if (impl::pidfd_try_reap(pidfds[index], info, usage) == -1)
+                finish(index, core::posix::wait::Result{});
+            else if (info.si_pid != 0)
+                finish(index, impl::result_from_siginfo(info));
         }
     }
 
-    mutable std::mutex guard;
-    std::unordered_map<pid_t, core::posix::ChildProcess> children;
-    core::ScopedConnection on_sig_child_connection;
-    struct
+    cleanup();
+    return changes;
+}
+}
+
+impl::KnownChildren::Fork::Fork() : active(true)
+{
+    auto& known = KnownChildren::instance();
+
+    std::lock_guard<std::mutex> lg(known.guard);
+    known.forks_in_flight++;
+}
+
+impl::KnownChildren::Fork::~Fork()
+{
+    if (!active)
+        return;
+
+    auto& known = KnownChildren::instance();
+
+    std::lock_guard<std::mutex> lg(known.guard);
+    if (--known.forks_in_flight == 0)
+        known.forks_completed.notify_all();
+}
+
+void impl::KnownChildren::Fork::in_child()
+{
+    // We are the only thread in the child, so no locking is required.
+    active = false;
+    KnownChildren::instance().forks_in_flight = 0;
+}
+
+impl::KnownChildren& impl::KnownChildren::instance()
+{
+    static KnownChildren* instance = new KnownChildren();
+    return *instance;
+}
+
+void impl::KnownChildren::add(pid_t pid)
+{
+    std::lock_guard<std::mutex> lg(guard);
+    pids[pid]++;
+}
+
+void impl::KnownChildren::remove(pid_t pid)
+{
+    std::lock_guard<std::mutex> lg(guard);
+
+    auto it = pids.find(pid);
+    if (it != pids.end() && --it->second == 0)
+        pids.erase(it);
+}
+
+void impl::KnownChildren::detach(pid_t pid)
+{
+    std::lock_guard<std::mutex> lg(guard);
+
+    detached.insert(pid);
+
+    auto it = pids.find(pid);
+    if (it != pids.end() && --it->second == 0)
+        pids.erase(it);
+}
+
+void impl::KnownChildren::forget(pid_t pid)
+{
+    std::lock_guard<std::mutex> lg(guard);
+    detached.erase(pid);
+}
+
+bool impl::KnownChildren::is_orphan(pid_t pid)
+{
+    std::unique_lock<std::mutex> ul(guard);
+
+    forks_completed.wait(ul, [this]() { return forks_in_flight == 0; });
+    return pids.count(pid) == 0 && detached.count(pid) == 0;
+}
+
+constexpr std::size_t core::posix::ChildProcess::DeathObserver::default_exit_history_size;
+
+std::unique_ptr<core::posix::ChildProcess::DeathObserver>
+core::posix::ChildProcess::DeathObserver::create_with_signal_trap(
+        std::shared_ptr<core::posix::SignalTrap> trap)
+{
+    return std::unique_ptr<core::posix::ChildProcess::DeathObserver>
     {
-        core::Signal<core::posix::ChildProcess> child_died;
-    } signals;
-};
+        new DeathObserverImpl{trap}
+    };
 }
 
 std::unique_ptr<core::posix::ChildProcess::DeathObserver>
@@ -163,12 +1126,7 @@ core::posix::ChildProcess::DeathObserver::create_once_with_signal_trap(
 
     try
     {
-        std::unique_ptr<core::posix::ChildProcess::DeathObserver> result
-        {
-            new DeathObserverImpl{trap}
-        };
-
-        return result;
+        return create_with_signal_trap(trap);
     } catch(...)
     {
         // We make sure that a throwing c'tor does not impact our ability to
@@ -200,7 +1158,10 @@ ChildProcess::Pipe ChildProcess::Pipe::invalid()
 
 ChildProcess::Pipe::Pipe()
 {
-    int rc = ::pipe(fds);
+    // We create the pipe with O_CLOEXEC to prevent other children from
+    // inheriting our ends of it across exec, which would keep the pipe
+    // open. dup2'ing the child's end to a standard stream clears the flag.
+    int rc = ::pipe2(fds, O_CLOEXEC);
 
     if (rc == -1)
         throw std::system_error(errno, std::system_category());
@@ -209,10 +1170,10 @@ ChildProcess::Pipe::Pipe()
 ChildProcess::Pipe::Pipe(const ChildProcess::Pipe& rhs) : fds{-1, -1}
 {
     if (rhs.fds[0] != -1)
-        fds[0] = ::dup(rhs.fds[0]);
+        fds[0] = ::fcntl(rhs.fds[0], F_DUPFD_CLOEXEC, 0);
 
     if (rhs.fds[1] != -1)
-        fds[1] = ::dup(rhs.fds[1]);
+        fds[1] = ::fcntl(rhs.fds[1], F_DUPFD_CLOEXEC, 0);
 }
 
 ChildProcess::Pipe::~Pipe()
@@ -259,11 +1220,11 @@ ChildProcess::Pipe& ChildProcess::Pipe::operator=(const ChildProcess::Pipe& rhs)
         ::close(fds[1]);
 
     if (rhs.fds[0] != -1)
-        fds[0] = ::dup(rhs.fds[0]);
+        fds[0] = ::fcntl(rhs.fds[0], F_DUPFD_CLOEXEC, 0);
     else
         fds[0] = -1;
     if (rhs.fds[1] != -1)
-        fds[1] = ::dup(rhs.fds[1]);
+        fds[1] = ::fcntl(rhs.fds[1], F_DUPFD_CLOEXEC, 0);
     else
         fds[1] = -1;
 
@@ -275,6 +1236,7 @@ struct ChildProcess::Private
     // stdin and stdout are always "relative" to the childprocess, i.e., we
     // write to stdin of the child process and read from its stdout.
     Private(pid_t pid,
+            int pidfd,
             const ChildProcess::Pipe& stderr,
             const ChildProcess::Pipe& stdin,
             const ChildProcess::Pipe& stdout)
@@ -286,22 +1248,77 @@ struct ChildProcess::Private
           cin(&sin),
           cout(&sout),
           original_parent_pid(::getpid()),
-          original_child_pid(pid)
+          original_child_pid(pid),
+          pidfd(pidfd),
+          destruction_policy(default_destruction_policy().load())
     {
+        if (original_child_pid > 1)
+            impl::KnownChildren::instance().add(original_child_pid);
     }
 
     ~Private()
     {
-        // Check if we are in the original parent process.
-        if (original_parent_pid == getpid())
+        // Check if we are considering a valid pid here.
+        if (original_child_pid <= 1)
+            return;
+
+        auto& known = impl::KnownChildren::instance();
+
+        // Check if we are in the original parent process. We might have
+        // been forked, and the child is not ours to take care of, then.
+        if (original_parent_pid != getpid())
+        {
+            known.remove(original_child_pid);
+            return;
+        }
+
+        // The child stays known until it has been reaped, such that observers
+        // do not mistake it for an orphan. Detaching before checking on the
+        // child makes sure that reaping it concurrently forgets about it.
+        known.detach(original_child_pid);
+
+        // Without a pidfd, we cannot tell whether the pid still refers to our
+        // child, and leave it alone.
+        if (pidfd == -1 || impl::pidfd_is_reaped(pidfd))
+        {
+            known.forget(original_child_pid);
+            return;
+        }
+
+        auto policy = destruction_policy.load();
+
+        if (policy == ChildProcess::DestructionPolicy::keep_running)
+            return;
+
+        // The pidfd never refers to anything but our child, even if it has
+        // been reaped in the meantime.
+        if (policy == ChildProcess::DestructionPolicy::kill_and_reap)
+            impl::pidfd_send_signal(pidfd, SIGKILL);
+
+        // The child is reaped already if somebody asked for its exit.
+        if (exit.requested)
+            return;
+
+        try
         {
-            // If so, check if we are considering a valid pid here.
-            // If so, we kill the original child.
-            if (original_child_pid != -1)
-                ::kill(original_child_pid, SIGKILL);
+            ExitWatcher::instance().watch(original_child_pid, pidfd);
+        } catch(...)
+        {
+            // The child is left as a zombie, for anybody to reap.
+            known.forget(original_child_pid);
         }
     }
 
+    static std::atomic<ChildProcess::DestructionPolicy>& default_destruction_policy()
+    {
+        static std::atomic<ChildProcess::DestructionPolicy> policy
+        {
+            ChildProcess::DestructionPolicy::kill_and_reap
+        };
+
+        return policy;
+    }
+
     struct
     {
         ChildProcess::Pipe stdin;
@@ -320,8 +1337,31 @@ struct ChildProcess::Private
     // is called from the child process.
     pid_t original_parent_pid;
     pid_t original_child_pid;
+
+    // Owned by the Process part of the ChildProcess instances sharing this
+    // state, which outlives us. -1 if the kernel lacks pidfd support.
+    int pidfd;
+
+    struct
+    {
+        std::mutex guard;
+        bool requested{false};
+        std::shared_future<wait::Result> future;
+    } exit;
+
+    std::atomic<ChildProcess::DestructionPolicy> destruction_policy;
 };
 
+void ChildProcess::set_default_destruction_policy(ChildProcess::DestructionPolicy policy)
+{
+    Private::default_destruction_policy() = policy;
+}
+
+ChildProcess::DestructionPolicy ChildProcess::default_destruction_policy()
+{
+    return Private::default_destruction_policy().load();
+}
+
 ChildProcess ChildProcess::invalid()
 {
     // We take the init process as child.
@@ -333,8 +1373,8 @@ ChildProcess::ChildProcess(pid_t pid,
                            const ChildProcess::Pipe& stdin_pipe,
                            const ChildProcess::Pipe& stdout_pipe,
                            const ChildProcess::Pipe& stderr_pipe)
-    : Process(pid),
-      d(new Private{pid, stdin_pipe, stdout_pipe, stderr_pipe})
+    : Process(pid, pid > 1 ? impl::pidfd_open(pid) : -1, -1),
+      d(new Private{pid, pidfd(), stdin_pipe, stdout_pipe, stderr_pipe})
 {
 }
 
@@ -350,33 +1390,92 @@ wait::Result ChildProcess::wait_for(const wait::Flags& flags)
     if (result_pid == -1)
         throw std::system_error(errno, std::system_category());
 
-    wait::Result result;
-
     if (result_pid == 0)
     {
+        wait::Result result;
         result.status = wait::Result::Status::no_state_change;
         return result;
     }
 
-    if (WIFEXITED(status))
-    {
-        result.status = wait::Result::Status::exited;
-        result.detail.if_exited.status = static_cast<exit::Status>(WEXITSTATUS(status));
-    } else if (WIFSIGNALED(status))
-    {
-        result.status = wait::Result::Status::signaled;
-        result.detail.if_signaled.signal = static_cast<Signal>(WTERMSIG(status));
-        result.detail.if_signaled.core_dumped = WCOREDUMP(status);
-    } else if (WIFSTOPPED(status))
+    return impl::result_from_status(status);
+}
+
+wait::Result ChildProcess::wait_for(const wait::Flags& flags, const std::chrono::nanoseconds& timeout)
+{
+    // Huge timeouts, e.g., nanoseconds::max(), would overflow the deadline.
+    auto now = std::chrono::steady_clock::now();
+    auto deadline = timeout < std::chrono::steady_clock::time_point::max() - now ?
+                now + timeout :
+                std::chrono::steady_clock::time_point::max();
+
+    return wait_until(flags, deadline);
+}
+
+wait::Result ChildProcess::wait_until(const wait::Flags& flags, const std::chrono::steady_clock::time_point& deadline)
+{
+    // A pidfd only becomes readable once the child has terminated, other
+    // state changes do not wake us up.
+    static const std::chrono::milliseconds slice{10};
+
+    const auto no_hang = flags | wait::Flags::no_hang;
+    const bool only_termination =
+            (static_cast<int>(flags) & (static_cast<int>(wait::Flags::untraced) | static_cast<int>(wait::Flags::continued))) == 0;
+
+    // The pidfd is owned by this instance and refers to the child even if
+    // its pid has been recycled, so we neither open nor close one per wait.
+    int pidfd = this->pidfd();
+
+    while (true)
     {
-        result.status = wait::Result::Status::stopped;
-        result.detail.if_stopped.signal = static_cast<Signal>(WSTOPSIG(status));
-    } else if (WIFCONTINUED(status))
+        auto result = wait_for(no_hang);
+        auto now = std::chrono::steady_clock::now();
+
+        if (result.status != wait::Result::Status::no_state_change || now >= deadline)
+            return result;
+
+        auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now);
+        if (pidfd == -1 || !only_termination)
+            remaining = std::min<std::chrono::nanoseconds>(remaining, slice);
+
+        ::timespec ts
+        {
+            static_cast<time_t>(std::chrono::duration_cast<std::chrono::seconds>(remaining).count()),
+            static_cast<long>((remaining % std::chrono::seconds{1}).count())
+        };
+
+        if (pidfd == -1)
+        {
+            ::nanosleep(&ts, nullptr);
+            continue;
+        }
+
+        ::pollfd pfd{pidfd, POLLIN, 0};
+        if (::ppoll(&pfd, 1, &ts, nullptr) == -1 && errno != EINTR)
+            throw std::system_error(errno, std::system_category());
+    }
+}
+
+std::shared_future<wait::Result> ChildProcess::exit_future()
+{
+    std::lock_guard<std::mutex> lg(d->exit.guard);
+
+    if (!d->exit.requested)
     {
-        result.status = wait::Result::Status::continued;
+        d->exit.future = ExitWatcher::instance().watch(pid(), pidfd());
+        d->exit.requested = true;
     }
 
-    return result;
+    return d->exit.future;
+}
+
+void ChildProcess::set_destruction_policy(ChildProcess::DestructionPolicy policy)
+{
+    d->destruction_policy = policy;
+}
+
+ChildProcess::DestructionPolicy ChildProcess::destruction_policy() const
+{
+    return d->destruction_policy.load();
 }
 
 std::istream& ChildProcess::cerr()
@@ -393,5 +1492,96 @@ std::istream& ChildProcess::cout()
 {
     return d->cout;
 }
+
+void ChildProcess::close_stdin()
+{
+    if (d->pipes.stdin.write_fd() == -1)
+        return;
+
+    d->cin.flush();
+    d->pipes.stdin.close_write_fd();
+}
+
+int ChildProcess::native_handle(StandardStream stream) const
+{
+    switch (stream)
+    {
+    case StandardStream::stdin:
+        return d->pipes.stdin.write_fd();
+    case StandardStream::stdout:
+        return d->pipes.stdout.read_fd();
+    case StandardStream::stderr:
+        return d->pipes.stderr.read_fd();
+    default:
+        return -1;
+    }
+}
+
+std::vector<wait::Change> wait_any(const std::vector<ChildProcess>& children)
+{
+    return wait_for_set(children, false, std::chrono::steady_clock::time_point::max());
+}
+
+std::vector<wait::Change> wait_any(
+        const std::vector<ChildProcess>& children,
+        const std::chrono::steady_clock::time_point& deadline)
+{
+    return wait_for_set(children, false, deadline);
+}
+
+std::vector<wait::Change> wait_all(const std::vector<ChildProcess>& children)
+{
+    return wait_for_set(children, true, std::chrono::steady_clock::time_point::max());
+}
+
+std::vector<wait::Change> wait_all(
+        const std::vector<ChildProcess>& children,
+        const std::chrono::steady_clock::time_point& deadline)
+{
+    return wait_for_set(children, true, deadline);
+}
+
+std::vector<wait::Change> shutdown(
+        const std::vector<ChildProcess>& children,
+        const std::chrono::nanoseconds& grace_period,
+        Signal signal)
+{
+    // Children might have terminated on their own already. Signals are sent
+    // via the handles, which never reach a process that recycled the pid of
+    // a child reaped before.
+    std::error_code ignored;
+    for (auto child : children)
+        child.send_signal(signal, ignored);
+
+    auto changes = wait_all(children, std::chrono::steady_clock::now() + grace_period);
+
+    if (changes.size() == children.size())
+        return changes;
+
+    std::vector<bool> terminated(children.size(), false);
+    for (const auto& change : changes)
+        terminated[change.index] = true;
+
+    std::vector<ChildProcess> stragglers;
+    std::vector<std::size_t> indices;
+
+    for (std::size_t i = 0; i < children.size(); i++)
+    {
+        if (terminated[i])
+            continue;
+
+        stragglers.push_back(children[i]);
+        stragglers.back().send_signal(Signal::sig_kill, ignored);
+        indices.push_back(i);
+    }
+
+    for (auto change : wait_all(stragglers))
+    {
+        change.index = indices[change.index];
+        changes.push_back(change);
+    }
+
+    return changes;
+}
 }
 }
@@ -0,0 +1,322 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Thomas Voß <thomas.voss@canonical.com>
+ */
+
+#include <core/posix/coroutines.h>
+
+#include "linux/pidfd.h"
+
+#include <atomic>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace coro = core::posix::coroutines;
+
+namespace
+{
+// A fire-and-forget coroutine, used to run spawned tasks. Its frame is
+// destroyed automatically once it has finished.
+struct Detached
+{
+    struct promise_type
+    {
+        Detached get_return_object() noexcept
+        {
+            return Detached{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        std::suspend_always initial_suspend() const noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never final_suspend() const noexcept
+        {
+            return {};
+        }
+
+        void return_void() const noexcept
+        {
+        }
+
+        void unhandled_exception() const noexcept
+        {
+            std::terminate();
+        }
+    };
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+void set_non_blocking(int fd)
+{
+    if (fd == -1)
+        return;
+
+    int flags = ::fcntl(fd, F_GETFL);
+    if (flags != -1 && !(flags & O_NONBLOCK))
+        ::fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+}
+
+coro::Readable::Readable(core::posix::IoEngine& engine, int fd)
+    : engine(engine),
+      fd(fd),
+      suspended(false),
+      done(false)
+{
+}
+
+bool coro::Readable::await_ready() const noexcept
+{
+    return false;
+}
+
+bool coro::Readable::await_suspend(std::coroutine_handle<> h)
+{
+    handle = h;
+
+    // The engine might report an error right away, in which case we
+    // continue without suspending.
+    engine.async_wait_readable(fd, [this](const std::error_code& e)
+    {
+        error = e;
+        done = true;
+
+        if (suspended)
+            handle.resume();
+    });
+
+    suspended = !done;
+    return suspended;
+}
+
+void coro::Readable::await_resume() const
+{
+    if (error)
+        throw std::system_error(error);
+}
+
+coro::WriteSome::WriteSome(core::posix::IoEngine& engine, int fd, std::span<const char> buffer)
+    : engine(engine),
+      fd(fd),
+      buffer(buffer),
+      size(0),
+      suspended(false),
+      done(false)
+{
+}
+
+bool coro::WriteSome::await_ready() const noexcept
+{
+    return false;
+}
+
+bool coro::WriteSome::await_suspend(std::coroutine_handle<> h)
+{
+    handle = h;
+
+    ::iovec iov{const_cast<char*>(buffer.data()), buffer.size()};
+    engine.async_write_some(fd, &iov, 1, [this](std::size_t n, const std::error_code& e)
+    {
+        size = n;
+        error = e;
+        done = true;
+
+        if (suspended)
+            handle.resume();
+    });
+
+    suspended = !done;
+    return suspended;
+}
+
+std::size_t coro::WriteSome::await_resume() const
+{
+    if (error)
+        throw std::system_error(error);
+
+    return size;
+}
+
+namespace
+{
+// State shared between an executor and the tasks spawned on it.
+struct State
+{
+    std::shared_ptr<core::posix::IoEngine> engine;
+    std::atomic<std::size_t> outstanding{0};
+    std::exception_ptr failure; // Only ever accessed on the engine's thread.
+};
+
+Detached launch(std::shared_ptr<State> state, coro::Task<void> task)
+{
+    try
+    {
+        co_await std::move(task);
+    } catch(...)
+    {
+        if (!state->failure)
+            state->failure = std::current_exception();
+    }
+
+    if (--state->outstanding == 0)
+        state->engine->stop();
+}
+}
+
+struct coro::Executor::Private
+{
+    std::shared_ptr<State> state;
+};
+
+coro::Executor::Executor() : Executor(core::posix::create_io_engine())
+{
+}
+
+coro::Executor::Executor(const std::shared_ptr<core::posix::IoEngine>& engine)
+    : d(new Private{std::make_shared<State>()})
+{
+    d->state->engine = engine;
+}
+
+coro::Executor::~Executor()
+{
+}
+
+const std::shared_ptr<core::posix::IoEngine>& coro::Executor::engine() const
+{
+    return d->state->engine;
+}
+
+void coro::Executor::spawn(coro::Task<void> task)
+{
+    d->state->outstanding++;
+
+    // The task starts executing on the engine's thread.
+    auto handle = launch(d->state, std::move(task)).handle;
+    d->state->engine->post([handle]() { handle.resume(); });
+}
+
+void coro::Executor::run()
+{
+    if (d->state->outstanding.load() > 0)
+        d->state->engine->run();
+
+    if (d->state->failure)
+        std::rethrow_exception(std::exchange(d->state->failure, nullptr));
+}
+
+coro::Readable coro::Executor::readable(int fd)
+{
+    return Readable{*d->state->engine, fd};
+}
+
+coro::WriteSome coro::Executor::write_some(int fd, std::span<const char> buffer)
+{
+    return WriteSome{*d->state->engine, fd, buffer};
+}
+
+struct coro::Child::Private
+{
+    // Waiting on our own duplicate of the child's pidfd keeps referring
+    // to the child, even if its pid has been recycled.
+    Private(coro::Executor& executor, const core::posix::ChildProcess& child)
+        : executor(executor),
+          child(child),
+          pidfd(impl::pidfd_dup_or_open(child.pidfd(), child.pid()))
+    {
+        if (pidfd == -1)
+            throw std::system_error(errno, std::system_category());
+
+        set_non_blocking(this->child.native_handle(core::posix::StandardStream::stdin));
+        set_non_blocking(this->child.native_handle(core::posix::StandardStream::stdout));
+        set_non_blocking(this->child.native_handle(core::posix::StandardStream::stderr));
+    }
+
+    ~Private()
+    {
+        ::close(pidfd);
+    }
+
+    int fd_or_throw(core::posix::StandardStream stream) const
+    {
+        int fd = child.native_handle(stream);
+        if (fd == -1)
+            throw std::logic_error("coroutines::Child: The requested stream of the child has not been redirected.");
+
+        return fd;
+    }
+
+    coro::Executor& executor;
+    core::posix::ChildProcess child;
+    int pidfd;
+};
+
+coro::Child::Child(coro::Executor& executor, const core::posix::ChildProcess& child)
+    : d(new Private{executor, child})
+{
+}
+
+core::posix::ChildProcess& coro::Child::process()
+{
+    return d->child;
+}
+
+coro::Task<core::posix::wait::Result> coro::Child::exited()
+{
+    // The pidfd becomes readable once the child has terminated, reaping
+    // it is guaranteed not to block from then on.
+    co_await d->executor.readable(d->pidfd);
+    co_return d->child.wait_for(core::posix::wait::Flags::no_hang);
+}
+
+coro::Task<std::size_t> coro::Child::read_some(std::span<char> buffer)
+{
+    return read_some(core::posix::StandardStream::stdout, buffer);
+}
+
+coro::Task<std::size_t> coro::Child::read_some(core::posix::StandardStream stream, std::span<char> buffer)
+{
+    int fd = d->fd_or_throw(stream);
+
+    while (true)
+    {
+        auto rc = ::read(fd, buffer.data(), buffer.size());
+
+        if (rc >= 0)
+            co_return rc;
+
+        if (errno == EINTR)
+            continue;
+
+        if (errno != EAGAIN)
+            throw std::system_error(errno, std::system_category());
+
+        co_await d->executor.readable(fd);
+    }
+}
+
+coro::Task<void> coro::Child::write(std::span<const char> buffer)
+{
+    int fd = d->fd_or_throw(core::posix::StandardStream::stdin);
+
+    while (!buffer.empty())
+        buffer = buffer.subspan(co_await d->executor.write_some(fd, buffer));
+}
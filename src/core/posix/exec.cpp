@@ -44,6 +44,16 @@ ChildProcess exec(const std::string& fn,
                   const std::map<std::string, std::string>& env,
                   const StandardStream& flags,
                   const std::function<void()>& child_setup)
+{
+    return exec(fn, argv, env, flags, child_setup, Grouping::inherit());
+}
+
+ChildProcess exec(const std::string& fn,
+                  const std::vector<std::string>& argv,
+                  const std::map<std::string, std::string>& env,
+                  const StandardStream& flags,
+                  const std::function<void()>& child_setup,
+                  const Grouping& grouping)
 {
     return posix::fork([fn, argv, env, child_setup]()
     {
@@ -68,7 +78,7 @@ ChildProcess exec(const std::string& fn,
 
         child_setup();
         return static_cast<posix::exit::Status>(execve(fn.c_str(), pargv, penv));
-    }, flags);
+    }, flags, grouping);
 }
 
 }
@@ -20,13 +20,18 @@
 #include <core/posix/fork.h>
 
 #include "backtrace.h"
+#include "known_children.h"
 
 #include <iomanip>
 #include <iostream>
 #include <system_error>
 
+#include <fcntl.h>
+#include <signal.h>
 #include <unistd.h>
 
+#include <sys/wait.h>
+
 namespace
 {
 void redirect_stream_to_fd(int fd, int stream)
@@ -36,6 +41,30 @@ void redirect_stream_to_fd(int fd, int stream)
         throw std::system_error(errno, std::system_category());
 }
 
+// Places the calling process as described by grouping.
+void apply_grouping(const core::posix::Grouping& grouping)
+{
+    int rc{0};
+
+    switch (grouping.kind)
+    {
+    case core::posix::Grouping::Kind::inherit:
+        break;
+    case core::posix::Grouping::Kind::new_process_group:
+        rc = ::setpgid(0, 0);
+        break;
+    case core::posix::Grouping::Kind::join_process_group:
+        rc = ::setpgid(0, grouping.process_group_id);
+        break;
+    case core::posix::Grouping::Kind::new_session:
+        rc = ::setsid();
+        break;
+    }
+
+    if (rc == -1)
+        throw std::system_error(errno, std::system_category());
+}
+
 void print_backtrace(std::ostream& out, const std::string& line_prefix)
 {
     core::posix::backtrace::visit_with_handler([&out, line_prefix](const core::posix::backtrace::Frame& frame)
@@ -56,6 +85,13 @@ bool is_child(pid_t pid) { return pid == 0; }
 
 ChildProcess fork(const std::function<posix::exit::Status()>& main,
                   const StandardStream& flags)
+{
+    return fork(main, flags, Grouping::inherit());
+}
+
+ChildProcess fork(const std::function<posix::exit::Status()>& main,
+                  const StandardStream& flags,
+                  const Grouping& grouping)
 {
     ChildProcess::Pipe stdin_pipe{ChildProcess::Pipe::invalid()};
     ChildProcess::Pipe stdout_pipe{ChildProcess::Pipe::invalid()};
@@ -68,17 +104,52 @@ ChildProcess fork(const std::function<posix::exit::Status()>& main,
     if ((flags & StandardStream::stderr) != StandardStream::empty)
         stderr_pipe = ChildProcess::Pipe();
 
+    // Only the child can start a new session, and we have to make sure that
+    // it did before handing out the child. The child writes a single byte
+    // once it leads its session. Children forked concurrently by other
+    // threads might inherit the write end, so we must not wait for EOF.
+    int session_started[2] = {-1, -1};
+    if (grouping.kind == Grouping::Kind::new_session && ::pipe2(session_started, O_CLOEXEC) == -1)
+        throw std::system_error(errno, std::system_category());
+
+    // Orphan detection must not mistake the child for an orphan
+    // until the ChildProcess instance referring to it exists.
+    impl::KnownChildren::Fork in_flight;
+
     pid_t pid = ::fork();
 
     if (pid == -1)
-        throw std::system_error(errno, std::system_category());
+    {
+        std::error_code ec(errno, std::system_category());
+
+        if (session_started[0] != -1)
+        {
+            ::close(session_started[0]);
+            ::close(session_started[1]);
+        }
+
+        throw std::system_error(ec);
+    }
 
     if (is_child(pid))
     {
+        in_flight.in_child();
+
         posix::exit::Status result = posix::exit::Status::failure;
 
         try
         {
+            apply_grouping(grouping);
+
+            if (session_started[0] != -1)
+            {
+                char c{0};
+                while (::write(session_started[1], &c, 1) == -1 && errno == EINTR);
+
+                ::close(session_started[0]);
+                ::close(session_started[1]);
+            }
+
             stdin_pipe.close_write_fd();
             stdout_pipe.close_read_fd();
             stderr_pipe.close_read_fd();
@@ -109,6 +180,40 @@ ChildProcess fork(const std::function<posix::exit::Status()>& main,
 
     // We are in the parent process, and create a process object
     // corresponding to the newly forked process.
+    switch (grouping.kind)
+    {
+    case Grouping::Kind::new_process_group:
+    case Grouping::Kind::join_process_group:
+        // Placing the child from both sides closes the window in which
+        // signals or waits targeting the group would miss it. The child
+        // might have exec'd already, which is fine.
+        ::setpgid(pid, grouping.kind == Grouping::Kind::new_process_group ? pid : grouping.process_group_id);
+        break;
+    case Grouping::Kind::new_session:
+    {
+        ::close(session_started[1]);
+
+        char c;
+        ssize_t rc{0};
+        while ((rc = ::read(session_started[0], &c, 1)) == -1 && errno == EINTR);
+        ::close(session_started[0]);
+
+        // EOF without the byte means that the child failed to start its
+        // session, for which setsid only knows a single reason. We reap the
+        // child instead of handing it out, making sure it does not linger.
+        if (rc != 1)
+        {
+            std::error_code ec(rc == -1 ? errno : EPERM, std::system_category());
+            ::kill(pid, SIGKILL);
+            while (::waitpid(pid, nullptr, 0) == -1 && errno == EINTR);
+            throw std::system_error(ec);
+        }
+        break;
+    }
+    case Grouping::Kind::inherit:
+        break;
+    }
+
     stdin_pipe.close_read_fd();
     stdout_pipe.close_write_fd();
     stderr_pipe.close_write_fd();
@@ -121,9 +226,20 @@ ChildProcess fork(const std::function<posix::exit::Status()>& main,
 
 ChildProcess vfork(const std::function<posix::exit::Status()>& main,
                    const StandardStream& flags)
+{
+    return vfork(main, flags, Grouping::inherit());
+}
+
+ChildProcess vfork(const std::function<posix::exit::Status()>& main,
+                   const StandardStream& flags,
+                   const Grouping& grouping)
 {
     ChildProcess::Pipe stdin_pipe, stdout_pipe, stderr_pipe;
 
+    // Orphan detection must not mistake the child for an orphan
+    // until the ChildProcess instance referring to it exists.
+    impl::KnownChildren::Fork in_flight;
+
     pid_t pid = ::vfork();
 
     if (pid == -1)
@@ -135,6 +251,10 @@ ChildProcess vfork(const std::function<posix::exit::Status()>& main,
 
         try
         {
+            // The parent is suspended until we exit, so nobody can
+            // observe the child before it has been placed.
+            apply_grouping(grouping);
+
             // We replace stdin and stdout of the child process first:
             stdin_pipe.close_write_fd();
             stdout_pipe.close_read_fd();
@@ -0,0 +1,416 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Thomas Voß <thomas.voss@canonical.com>
+ */
+
+#include <core/posix/io_engine.h>
+
+#include "io_engine_support.h"
+#include "linux/io_uring_engine.h"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <unistd.h>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+namespace impl
+{
+class EpollIoEngine : public core::posix::IoEngine
+{
+public:
+    EpollIoEngine()
+        : epoll_fd(::epoll_create1(EPOLL_CLOEXEC)),
+          event_fd(::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+          stop_requested(false),
+          runner(std::thread::id()),
+          buffer(64 * 1024)
+    {
+        if (epoll_fd == -1 || event_fd == -1)
+        {
+            auto e = errno;
+            cleanup();
+            throw std::system_error(e, std::system_category());
+        }
+
+        ::epoll_event ev; ev.events = EPOLLIN; ev.data.fd = event_fd;
+        if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, event_fd, &ev) == -1)
+        {
+            auto e = errno;
+            cleanup();
+            throw std::system_error(e, std::system_category());
+        }
+    }
+
+    ~EpollIoEngine()
+    {
+        cleanup();
+    }
+
+    void start_reading(int fd, const ReadHandler& handler) override
+    {
+        dispatch([this, fd, handler]()
+        {
+            set_non_blocking(fd, true);
+            registrations[fd].reader = handler;
+            update_interest(fd);
+        });
+    }
+
+    void async_write_some(int fd, const ::iovec* iov, int count, const WriteHandler& handler) override
+    {
+        WriteOperation op{std::vector<::iovec>(iov, iov + count), handler};
+        dispatch([this, fd, op]()
+        {
+            set_non_blocking(fd, true);
+            registrations[fd].writes.push_back(op);
+            update_interest(fd);
+        });
+    }
+
+    void async_wait_readable(int fd, const WaitHandler& handler) override
+    {
+        dispatch([this, fd, handler]()
+        {
+            registrations[fd].waiters.push_back(handler);
+            update_interest(fd);
+        });
+    }
+
+    void cancel(int fd) override
+    {
+        dispatch([this, fd]()
+        {
+            auto it = registrations.find(fd);
+            if (it == registrations.end())
+                return;
+
+            Registration r = std::move(it->second);
+            registrations.erase(it);
+            ::epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+            counters.system_calls++;
+
+            static const std::error_code canceled = std::make_error_code(std::errc::operation_canceled);
+
+            for (const auto& waiter : r.waiters)
+                waiter(canceled);
+            for (const auto& op : r.writes)
+                op.handler(0, canceled);
+            if (r.reader)
+                r.reader(nullptr, 0, canceled);
+        });
+    }
+
+    void post(const std::function<void()>& task) override
+    {
+        {
+            std::lock_guard<std::mutex> lg(guard);
+            tasks.push_back(task);
+        }
+        wake_up();
+    }
+
+    void run() override
+    {
+        static constexpr int max_events = 64;
+        ::epoll_event events[max_events];
+
+        SigPipeGuard sig_pipe_guard;
+        runner.store(std::this_thread::get_id());
+
+        while (!stop_requested.load())
+        {
+            auto rc = ::epoll_wait(epoll_fd, events, max_events, -1);
+            counters.system_calls++;
+
+            if (rc == -1)
+            {
+                if (errno == EINTR)
+                    continue;
+
+                break;
+            }
+
+            for (int i = 0; i < rc; i++)
+            {
+                if (events[i].data.fd == event_fd)
+                {
+                    std::uint64_t value;
+                    // Consciously void-ing the return value here.
+                    // Not much we can do about an error.
+                    auto result = ::read(event_fd, &value, sizeof(value));
+                    (void) result;
+                    counters.system_calls++;
+
+                    run_tasks();
+                }
+                else
+                {
+                    process(events[i].data.fd, events[i].events);
+                }
+            }
+        }
+
+        runner.store(std::thread::id());
+        stop_requested.store(false);
+    }
+
+    void stop() override
+    {
+        stop_requested.store(true);
+        wake_up();
+    }
+
+    Backend backend() const override
+    {
+        return Backend::epoll;
+    }
+
+    Statistics statistics() const override
+    {
+        return counters.snapshot();
+    }
+
+private:
+    struct WriteOperation
+    {
+        std::vector<::iovec> iov;
+        WriteHandler handler;
+    };
+
+    struct Registration
+    {
+        ReadHandler reader;
+        std::deque<WriteOperation> writes;
+        std::deque<WaitHandler> waiters;
+        std::uint32_t events{0};
+    };
+
+    void cleanup()
+    {
+        if (epoll_fd != -1)
+            ::close(epoll_fd);
+        if (event_fd != -1)
+            ::close(event_fd);
+    }
+
+    void wake_up()
+    {
+        static const std::uint64_t value{1};
+        counters.system_calls++;
+        if (sizeof(value) != ::write(event_fd, &value, sizeof(value)))
+            throw std::system_error(errno, std::system_category());
+    }
+
+    // Executes task right away if called on the thread running the engine,
+    // and queues it for execution on that thread otherwise.
+    void dispatch(const std::function<void()>& task)
+    {
+        if (runner.load() == std::this_thread::get_id())
+            task();
+        else
+            post(task);
+    }
+
+    void run_tasks()
+    {
+        std::deque<std::function<void()>> current;
+        {
+            std::lock_guard<std::mutex> lg(guard);
+            std::swap(current, tasks);
+        }
+
+        for (const auto& task : current)
+            task();
+    }
+
+    // Adjusts the epoll registration of fd to its pending operations. Handlers
+    // might add or cancel operations while being invoked, so we always
+    // look up the registration again instead of holding on to it.
+    void update_interest(int fd)
+    {
+        auto it = registrations.find(fd);
+        if (it == registrations.end())
+            return;
+
+        Registration& r = it->second;
+
+        std::uint32_t events{0};
+        if (r.reader || !r.waiters.empty())
+            events |= EPOLLIN;
+        if (!r.writes.empty())
+            events |= EPOLLOUT;
+
+        if (events == r.events)
+            return;
+
+        counters.system_calls++;
+
+        if (events == 0)
+        {
+            ::epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+            registrations.erase(it);
+            return;
+        }
+
+        ::epoll_event ev; ev.events = events; ev.data.fd = fd;
+        auto rc = ::epoll_ctl(epoll_fd, r.events == 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &ev);
+
+        if (rc == -1)
+        {
+            // The fd cannot be polled, e.g., because it refers to a regular
+            // file or has been closed. We fail all pending operations.
+            std::error_code e(errno, std::system_category());
+            Registration failed = std::move(r);
+            registrations.erase(it);
+
+            for (const auto& waiter : failed.waiters)
+                waiter(e);
+            for (const auto& op : failed.writes)
+                op.handler(0, e);
+            if (failed.reader)
+                failed.reader(nullptr, 0, e);
+
+            return;
+        }
+
+        r.events = events;
+    }
+
+    void process(int fd, std::uint32_t events)
+    {
+        if (events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+        {
+            process_readable(fd);
+        }
+
+        if (events & (EPOLLOUT | EPOLLHUP | EPOLLERR))
+        {
+            process_writable(fd);
+        }
+
+        update_interest(fd);
+    }
+
+    void process_readable(int fd)
+    {
+        auto it = registrations.find(fd);
+        if (it == registrations.end())
+            return;
+
+        std::deque<WaitHandler> waiters;
+        std::swap(waiters, it->second.waiters);
+
+        for (const auto& waiter : waiters)
+            waiter(std::error_code{});
+
+        it = registrations.find(fd);
+        if (it == registrations.end() || !it->second.reader)
+            return;
+
+        auto rc = ::read(fd, buffer.data(), buffer.size());
+        counters.system_calls++;
+
+        if (rc == -1 && (errno == EAGAIN || errno == EINTR))
+            return;
+
+        if (rc > 0)
+        {
+            counters.bytes_read += rc;
+
+            // Copy the handler as it might cancel itself.
+            auto reader = it->second.reader;
+            reader(buffer.data(), rc, std::error_code{});
+            return;
+        }
+
+        std::error_code e;
+        if (rc == -1)
+            e = std::error_code(errno, std::system_category());
+
+        ReadHandler reader;
+        std::swap(reader, it->second.reader);
+        reader(nullptr, 0, e);
+    }
+
+    void process_writable(int fd)
+    {
+        auto it = registrations.find(fd);
+        if (it == registrations.end() || it->second.writes.empty())
+            return;
+
+        const auto& front = it->second.writes.front();
+        auto rc = ::writev(fd, front.iov.data(), front.iov.size());
+        counters.system_calls++;
+
+        if (rc == -1 && (errno == EAGAIN || errno == EINTR))
+            return;
+
+        std::error_code e;
+        if (rc == -1)
+            e = std::error_code(errno, std::system_category());
+
+        if (rc > 0)
+            counters.bytes_written += rc;
+
+        auto op = std::move(it->second.writes.front());
+        it->second.writes.pop_front();
+
+        op.handler(rc == -1 ? 0 : rc, e);
+    }
+
+    int epoll_fd;
+    int event_fd;
+
+    std::atomic<bool> stop_requested;
+    std::atomic<std::thread::id> runner;
+    Counters counters;
+
+    std::mutex guard;
+    std::deque<std::function<void()>> tasks;
+
+    // Only ever accessed on the thread executing run().
+    std::unordered_map<int, Registration> registrations;
+    std::vector<char> buffer;
+};
+}
+
+std::shared_ptr<core::posix::IoEngine> core::posix::create_io_engine()
+{
+    return std::make_shared<impl::EpollIoEngine>();
+}
+
+std::shared_ptr<core::posix::IoEngine> core::posix::create_io_engine(core::posix::IoEngine::Backend backend)
+{
+    if (backend == IoEngine::Backend::io_uring)
+    {
+        try
+        {
+            return core::posix::linux::create_io_uring_engine();
+        } catch(const std::system_error&)
+        {
+            // io_uring is not available, we fall back to epoll.
+        }
+    }
+
+    return create_io_engine();
+}
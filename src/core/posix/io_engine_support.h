@@ -0,0 +1,86 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Thomas Voß <thomas.voss@canonical.com>
+ */
+
+#ifndef CORE_POSIX_IO_ENGINE_SUPPORT_H_
+#define CORE_POSIX_IO_ENGINE_SUPPORT_H_
+
+#include <core/posix/io_engine.h>
+
+#include <atomic>
+#include <cstdint>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+
+namespace impl
+{
+// Sets or clears O_NONBLOCK on fd, leaving it alone if it already matches.
+inline void set_non_blocking(int fd, bool non_blocking)
+{
+    int flags = ::fcntl(fd, F_GETFL);
+    if (flags == -1 || non_blocking == static_cast<bool>(flags & O_NONBLOCK))
+        return;
+
+    ::fcntl(fd, F_SETFL, non_blocking ? flags | O_NONBLOCK : flags & ~O_NONBLOCK);
+}
+
+// Blocks SIGPIPE for the calling thread while in scope. A SIGPIPE raised by
+// a write on this thread is consumed before the original mask is restored.
+struct SigPipeGuard
+{
+    SigPipeGuard()
+    {
+        ::sigemptyset(&mask);
+        ::sigaddset(&mask, SIGPIPE);
+        ::pthread_sigmask(SIG_BLOCK, &mask, &old_mask);
+    }
+
+    ~SigPipeGuard()
+    {
+        static const ::timespec no_wait{0, 0};
+        while (::sigtimedwait(&mask, nullptr, &no_wait) > 0);
+
+        ::pthread_sigmask(SIG_SETMASK, &old_mask, nullptr);
+    }
+
+    ::sigset_t mask;
+    ::sigset_t old_mask;
+};
+
+// Statistics are updated on the thread running the engine, but might be
+// queried from any thread.
+struct Counters
+{
+    core::posix::IoEngine::Statistics snapshot() const
+    {
+        return core::posix::IoEngine::Statistics
+        {
+            system_calls.load(std::memory_order_relaxed),
+            bytes_read.load(std::memory_order_relaxed),
+            bytes_written.load(std::memory_order_relaxed)
+        };
+    }
+
+    std::atomic<std::uint64_t> system_calls{0};
+    std::atomic<std::uint64_t> bytes_read{0};
+    std::atomic<std::uint64_t> bytes_written{0};
+};
+}
+
+#endif // CORE_POSIX_IO_ENGINE_SUPPORT_H_
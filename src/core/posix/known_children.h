@@ -0,0 +1,86 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Thomas Voß <thomas.voss@canonical.com>
+ */
+
+#ifndef CORE_POSIX_KNOWN_CHILDREN_H_
+#define CORE_POSIX_KNOWN_CHILDREN_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <sys/types.h>
+
+namespace impl
+{
+// Keeps track of the pids of the children that are referred to by a
+// ChildProcess instance in this process, or that have been let go by their
+// last instance but have not been reaped yet. A child of ours that is not
+// known here has been adopted by us as a subreaper.
+class KnownChildren
+{
+public:
+    // Marks the window between forking a child and handing out the
+    // ChildProcess instance referring to it, in the parent.
+    class Fork
+    {
+    public:
+        Fork();
+        ~Fork();
+
+        Fork(const Fork&) = delete;
+        Fork& operator=(const Fork&) = delete;
+
+        // Invoked in the child, which does not inherit any forks in flight.
+        void in_child();
+
+    private:
+        bool active;
+    };
+
+    // The instance is never destroyed, as ChildProcess instances might outlive static storage.
+    static KnownChildren& instance();
+
+    void add(pid_t pid);
+    void remove(pid_t pid);
+
+    // Invoked once the last instance referring to pid is gone before pid has
+    // been reaped. The child remains known until it is forgotten.
+    void detach(pid_t pid);
+
+    // Forgets a detached child, once it has been reaped or nobody is going
+    // to reap it. Has no effect on children that have not been detached.
+    void forget(pid_t pid);
+
+    // Returns true if pid does not refer to a known child, waiting for
+    // forks in flight to hand out their ChildProcess instances first.
+    bool is_orphan(pid_t pid);
+
+private:
+    KnownChildren() = default;
+
+    std::mutex guard;
+    std::condition_variable forks_completed;
+    std::size_t forks_in_flight{0};
+    std::unordered_map<pid_t, std::size_t> pids;
+    std::unordered_set<pid_t> detached;
+};
+}
+
+#endif // CORE_POSIX_KNOWN_CHILDREN_H_
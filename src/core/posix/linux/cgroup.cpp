@@ -0,0 +1,406 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Thomas Voß <thomas.voss@canonical.com>
+ */
+
+#include <core/posix/linux/cgroup.h>
+
+#include <core/posix/process.h>
+
+#include <fstream>
+#include <sstream>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <sys/stat.h>
+
+namespace
+{
+int open_directory(int dir, const std::string& path)
+{
+    return ::openat(dir, path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}
+
+void write_to(int dir, const char* file, const std::string& value, std::error_code& e)
+{
+    int fd = ::openat(dir, file, O_WRONLY | O_CLOEXEC);
+
+    if (fd == -1)
+    {
+        e = std::error_code(errno, std::system_category());
+        return;
+    }
+
+    if (::write(fd, value.data(), value.size()) != static_cast<ssize_t>(value.size()))
+        e = std::error_code(errno, std::system_category());
+
+    ::close(fd);
+}
+
+std::string read_from_or_throw(int dir, const char* file)
+{
+    int fd = ::openat(dir, file, O_RDONLY | O_CLOEXEC);
+
+    if (fd == -1)
+        throw std::system_error(errno, std::system_category());
+
+    std::string result;
+    char buffer[4096];
+
+    for (;;)
+    {
+        auto rc = ::read(fd, buffer, sizeof(buffer));
+
+        if (rc == -1 && errno == EINTR)
+            continue;
+
+        if (rc == -1)
+        {
+            std::error_code e(errno, std::system_category());
+            ::close(fd);
+            throw std::system_error(e);
+        }
+
+        if (rc == 0)
+            break;
+
+        result.append(buffer, rc);
+    }
+
+    ::close(fd);
+    return result;
+}
+
+// Looks up key in files made of "key value" lines, e.g., cgroup.events and cpu.stat.
+std::uint64_t value_of_or_throw(int dir, const char* file, const std::string& key)
+{
+    std::istringstream in(read_from_or_throw(dir, file));
+
+    std::string k; std::uint64_t value{0};
+    while (in >> k >> value)
+        if (k == key)
+            return value;
+
+    throw std::system_error(std::make_error_code(std::errc::no_message_available));
+}
+
+// Signals all processes in the cgroup referred to by dir and its descendants, one by one.
+void kill_one_by_one(int dir, std::error_code& e)
+{
+    try
+    {
+        std::istringstream in(read_from_or_throw(dir, "cgroup.procs"));
+
+        pid_t pid{-1};
+        while (in >> pid)
+            ::kill(pid, SIGKILL);
+    } catch(const std::system_error& se)
+    {
+        e = se.code();
+        return;
+    }
+
+    int copy = ::dup(dir);
+    DIR* children = copy == -1 ? nullptr : ::fdopendir(copy);
+
+    if (!children)
+    {
+        e = std::error_code(errno, std::system_category());
+        if (copy != -1)
+            ::close(copy);
+        return;
+    }
+
+    while (auto entry = ::readdir(children))
+    {
+        if (entry->d_type != DT_DIR || entry->d_name[0] == '.')
+            continue;
+
+        int child = open_directory(dir, entry->d_name);
+        if (child == -1)
+            continue;
+
+        kill_one_by_one(child, e);
+        ::close(child);
+    }
+
+    ::closedir(children);
+}
+
+// Finds the mount point of the cgroup v2 hierarchy, together with the root of the mount within the hierarchy.
+bool find_cgroup2_mount(std::string& mount_point, std::string& root)
+{
+    std::ifstream in("/proc/self/mountinfo");
+    std::string line;
+
+    while (std::getline(in, line))
+    {
+        // Optional fields precede the separator, the file system type follows it.
+        auto separator = line.find(" - ");
+        if (separator == std::string::npos || line.compare(separator + 3, 8, "cgroup2 ") != 0)
+            continue;
+
+        std::istringstream fields(line.substr(0, separator));
+        std::string id, parent, device;
+        fields >> id >> parent >> device >> root >> mount_point;
+
+        return true;
+    }
+
+    return false;
+}
+}
+
+namespace core
+{
+namespace posix
+{
+namespace linux
+{
+struct Cgroup::Private
+{
+    Private(const std::string& path, int fd) : path(path), fd(fd)
+    {
+    }
+
+    ~Private()
+    {
+        ::close(fd);
+    }
+
+    std::string path;
+    int fd;
+};
+
+Cgroup::Cgroup(const std::shared_ptr<Private>& d) : d(d)
+{
+}
+
+Cgroup Cgroup::of_this_process_or_throw()
+{
+    std::string mount_point, root;
+    if (!find_cgroup2_mount(mount_point, root))
+        throw std::system_error(std::make_error_code(std::errc::no_such_device));
+
+    // The unified hierarchy is reported with an id of 0 and no controllers.
+    std::ifstream in("/proc/self/cgroup");
+    std::string line;
+
+    while (std::getline(in, line))
+    {
+        if (line.compare(0, 3, "0::") != 0)
+            continue;
+
+        auto path = line.substr(3);
+
+        if (root != "/" && path.compare(0, root.size(), root) == 0)
+            path = path.substr(root.size());
+
+        return open_or_throw(path == "/" ? mount_point : mount_point + path);
+    }
+
+    throw std::system_error(std::make_error_code(std::errc::no_such_device));
+}
+
+Cgroup Cgroup::open_or_throw(const std::string& path)
+{
+    int fd = open_directory(AT_FDCWD, path);
+
+    if (fd == -1)
+        throw std::system_error(errno, std::system_category());
+
+    return Cgroup(std::make_shared<Private>(path, fd));
+}
+
+Cgroup Cgroup::create_child_or_throw(const std::string& name) const
+{
+    if (::mkdirat(d->fd, name.c_str(), 0755) == -1 && errno != EEXIST)
+        throw std::system_error(errno, std::system_category());
+
+    int fd = open_directory(d->fd, name);
+
+    if (fd == -1)
+        throw std::system_error(errno, std::system_category());
+
+    return Cgroup(std::make_shared<Private>(d->path + "/" + name, fd));
+}
+
+const std::string& Cgroup::path() const
+{
+    return d->path;
+}
+
+void Cgroup::add_or_throw(const Process& process)
+{
+    std::error_code e;
+    add(process, e);
+
+    if (e)
+        throw std::system_error(e);
+}
+
+void Cgroup::add(const Process& process, std::error_code& e) noexcept
+{
+    try
+    {
+        write_to(d->fd, "cgroup.procs", std::to_string(process.pid()), e);
+    } catch(const std::bad_alloc&)
+    {
+        e = std::make_error_code(std::errc::not_enough_memory);
+    }
+}
+
+std::function<void()> Cgroup::enter_in_child() const
+{
+    // The directory is inherited by the child, so entering the cgroup
+    // takes neither path lookups nor allocations.
+    auto d = this->d;
+    return [d]()
+    {
+        int fd = ::openat(d->fd, "cgroup.procs", O_WRONLY | O_CLOEXEC);
+
+        // Writing 0 moves the writing process.
+        if (fd == -1 || ::write(fd, "0", 1) != 1)
+            throw std::system_error(errno, std::system_category());
+
+        ::close(fd);
+    };
+}
+
+std::vector<pid_t> Cgroup::processes_or_throw() const
+{
+    std::istringstream in(read_from_or_throw(d->fd, "cgroup.procs"));
+
+    std::vector<pid_t> result;
+    pid_t pid{-1};
+    while (in >> pid)
+        result.push_back(pid);
+
+    return result;
+}
+
+bool Cgroup::is_populated_or_throw() const
+{
+    return value_of_or_throw(d->fd, "cgroup.events", "populated") == 1;
+}
+
+void Cgroup::freeze_or_throw()
+{
+    std::error_code e;
+    freeze(e);
+
+    if (e)
+        throw std::system_error(e);
+}
+
+void Cgroup::freeze(std::error_code& e) noexcept
+{
+    write_to(d->fd, "cgroup.freeze", "1", e);
+}
+
+void Cgroup::thaw_or_throw()
+{
+    std::error_code e;
+    thaw(e);
+
+    if (e)
+        throw std::system_error(e);
+}
+
+void Cgroup::thaw(std::error_code& e) noexcept
+{
+    write_to(d->fd, "cgroup.freeze", "0", e);
+}
+
+bool Cgroup::is_frozen_or_throw() const
+{
+    return value_of_or_throw(d->fd, "cgroup.events", "frozen") == 1;
+}
+
+void Cgroup::kill_or_throw()
+{
+    std::error_code e;
+    kill(e);
+
+    if (e)
+        throw std::system_error(e);
+}
+
+void Cgroup::kill(std::error_code& e) noexcept
+{
+    write_to(d->fd, "cgroup.kill", "1", e);
+
+    if (e != std::errc::no_such_file_or_directory)
+        return;
+
+    // Frozen processes cannot fork, but they still die from SIGKILL.
+    e.clear();
+    freeze(e);
+
+    if (e)
+        return;
+
+    kill_one_by_one(d->fd, e);
+
+    std::error_code ignored;
+    thaw(ignored);
+}
+
+Cgroup::CpuStat Cgroup::cpu_stat_or_throw() const
+{
+    std::istringstream in(read_from_or_throw(d->fd, "cpu.stat"));
+
+    CpuStat result;
+    std::string key; std::uint64_t value{0};
+
+    while (in >> key >> value)
+    {
+        if (key == "usage_usec")
+            result.usage = std::chrono::microseconds{value};
+        else if (key == "user_usec")
+            result.user = std::chrono::microseconds{value};
+        else if (key == "system_usec")
+            result.system = std::chrono::microseconds{value};
+    }
+
+    return result;
+}
+
+std::uint64_t Cgroup::memory_current_or_throw() const
+{
+    return std::stoull(read_from_or_throw(d->fd, "memory.current"));
+}
+
+void Cgroup::remove_or_throw()
+{
+    std::error_code e;
+    remove(e);
+
+    if (e)
+        throw std::system_error(e);
+}
+
+void Cgroup::remove(std::error_code& e) noexcept
+{
+    if (::rmdir(d->path.c_str()) == -1)
+        e = std::error_code(errno, std::system_category());
+}
+}
+}
+}
@@ -0,0 +1,801 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Thomas Voß <thomas.voss@canonical.com>
+ */
+
+#include "io_uring_engine.h"
+
+#include "../io_engine_support.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <poll.h>
+#include <unistd.h>
+
+#include <linux/io_uring.h>
+
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+namespace
+{
+// IORING_OP_READ_MULTISHOT has been added with Linux 6.7, the uapi headers
+// we build against might predate it. We probe for it at runtime.
+const std::uint8_t op_read_multishot = 49;
+
+// All reads draw from a single group of buffers provided to the kernel.
+// The kernel picks a buffer when data arrives, so the memory we need is
+// independent of the number of file descriptors we are reading from.
+const unsigned queue_depth = 256;
+const unsigned buffer_count = 128; // Has to be a power of two.
+const unsigned buffer_size = 32 * 1024;
+const std::uint16_t buffer_group = 0;
+
+// user_data values below first_operation_token are reserved.
+const std::uint64_t wake_up_token = 1;
+const std::uint64_t ignored_token = 2;
+const std::uint64_t first_operation_token = 16;
+
+int io_uring_setup(unsigned entries, ::io_uring_params* params)
+{
+    return ::syscall(__NR_io_uring_setup, entries, params);
+}
+
+int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    return ::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+}
+
+int io_uring_register(int fd, unsigned opcode, void* arg, unsigned nr_args)
+{
+    return ::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+void throw_system_error(int error)
+{
+    throw std::system_error(error, std::system_category());
+}
+
+class IoUringIoEngine : public core::posix::IoEngine
+{
+public:
+    IoUringIoEngine()
+        : stop_requested(false),
+          runner(std::thread::id())
+    {
+        try
+        {
+            setup_ring();
+            setup_buffers();
+            probe();
+
+            // The eventfd is blocking on purpose, io_uring takes care of
+            // waiting for it to become readable.
+            event_fd = ::eventfd(0, EFD_CLOEXEC);
+            if (event_fd == -1)
+                throw_system_error(errno);
+
+            arm_wake_up();
+        } catch(...)
+        {
+            cleanup();
+            throw;
+        }
+    }
+
+    ~IoUringIoEngine()
+    {
+        drain();
+        cleanup();
+    }
+
+    void start_reading(int fd, const ReadHandler& handler) override
+    {
+        dispatch([this, fd, handler]()
+        {
+            impl::set_non_blocking(fd, false);
+
+            auto id = next_token++;
+            Operation op; op.kind = Operation::Kind::read; op.fd = fd; op.reader = handler;
+            operations.emplace(id, std::move(op));
+            descriptors[fd].reader = id;
+
+            arm(id);
+        });
+    }
+
+    void async_write_some(int fd, const ::iovec* iov, int count, const WriteHandler& handler) override
+    {
+        Operation op; op.kind = Operation::Kind::write; op.fd = fd; op.writer = handler;
+        op.iov.assign(iov, iov + count);
+
+        dispatch([this, fd, op]()
+        {
+            impl::set_non_blocking(fd, false);
+
+            auto id = next_token++;
+            operations.emplace(id, op);
+
+            // Writes to the same fd are serialized to keep them in order.
+            auto& writes = descriptors[fd].writes;
+            writes.push_back(id);
+            if (writes.size() == 1)
+                arm(id);
+        });
+    }
+
+    void async_wait_readable(int fd, const WaitHandler& handler) override
+    {
+        dispatch([this, fd, handler]()
+        {
+            auto id = next_token++;
+            Operation op; op.kind = Operation::Kind::wait; op.fd = fd; op.waiter = handler;
+            operations.emplace(id, std::move(op));
+            descriptors[fd].waiters.push_back(id);
+
+            arm(id);
+        });
+    }
+
+    void cancel(int fd) override
+    {
+        dispatch([this, fd]()
+        {
+            auto it = descriptors.find(fd);
+            if (it == descriptors.end())
+                return;
+
+            Descriptor d = std::move(it->second);
+            descriptors.erase(it);
+
+            static const std::error_code canceled = std::make_error_code(std::errc::operation_canceled);
+
+            for (auto id : d.waiters)
+            {
+                auto waiter = operations[id].waiter;
+                abandon(id);
+                waiter(canceled);
+            }
+
+            for (std::size_t i = 0; i < d.writes.size(); i++)
+            {
+                // The kernel might be accessing the buffers of a write
+                // in flight, so we only report it once it has completed.
+                if (i == 0)
+                {
+                    operations[d.writes[i]].canceled = true;
+                    submit_cancel(d.writes[i]);
+                    continue;
+                }
+
+                auto writer = operations[d.writes[i]].writer;
+                operations.erase(d.writes[i]);
+                writer(0, canceled);
+            }
+
+            if (d.reader != 0)
+            {
+                auto reader = operations[d.reader].reader;
+                abandon(d.reader);
+                reader(nullptr, 0, canceled);
+            }
+        });
+    }
+
+    void post(const std::function<void()>& task) override
+    {
+        {
+            std::lock_guard<std::mutex> lg(guard);
+            tasks.push_back(task);
+        }
+        wake_up();
+    }
+
+    void run() override
+    {
+        impl::SigPipeGuard sig_pipe_guard;
+        runner.store(std::this_thread::get_id());
+
+        while (!stop_requested.load())
+        {
+            // Submits everything queued up since the last iteration and
+            // waits for at least one completion, with a single system call.
+            if (submit(1) == -1 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                break;
+
+            process_completions();
+        }
+
+        runner.store(std::thread::id());
+        stop_requested.store(false);
+    }
+
+    void stop() override
+    {
+        stop_requested.store(true);
+        wake_up();
+    }
+
+    Backend backend() const override
+    {
+        return Backend::io_uring;
+    }
+
+    Statistics statistics() const override
+    {
+        return counters.snapshot();
+    }
+
+private:
+    struct Operation
+    {
+        enum class Kind { read, write, wait };
+
+        Kind kind;
+        int fd;
+        ReadHandler reader;
+        WriteHandler writer;
+        WaitHandler waiter;
+        std::vector<::iovec> iov;
+        bool canceled{false}; // Completions are swallowed, apart from the final one of a write.
+        bool polling{false}; // Waiting for readiness before retrying an operation that reported EAGAIN.
+    };
+
+    struct Descriptor
+    {
+        std::uint64_t reader{0};
+        std::deque<std::uint64_t> writes;
+        std::vector<std::uint64_t> waiters;
+    };
+
+    void setup_ring()
+    {
+        ::io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        params.flags = IORING_SETUP_COOP_TASKRUN;
+
+        ring_fd = io_uring_setup(queue_depth, &params);
+
+        if (ring_fd == -1 && errno == EINVAL)
+        {
+            // Kernels before 5.19 do not know about cooperative task running.
+            std::memset(&params, 0, sizeof(params));
+            ring_fd = io_uring_setup(queue_depth, &params);
+        }
+
+        if (ring_fd == -1)
+            throw_system_error(errno);
+
+        if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_NODROP))
+            throw_system_error(ENOSYS);
+
+        ring_size = std::max(params.sq_off.array + params.sq_entries * sizeof(std::uint32_t),
+                             params.cq_off.cqes + params.cq_entries * sizeof(::io_uring_cqe));
+        ring = ::mmap(nullptr, ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+        if (ring == MAP_FAILED)
+        {
+            ring = nullptr;
+            throw_system_error(errno);
+        }
+
+        sqes_size = params.sq_entries * sizeof(::io_uring_sqe);
+        sqes = static_cast<::io_uring_sqe*>(
+                    ::mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED)
+        {
+            sqes = nullptr;
+            throw_system_error(errno);
+        }
+
+        auto base = static_cast<char*>(ring);
+        sq.head = reinterpret_cast<unsigned*>(base + params.sq_off.head);
+        sq.tail = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+        sq.mask = *reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+        sq.entries = params.sq_entries;
+        sq.array = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+        sq.local_tail = *sq.tail;
+
+        cq.head = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+        cq.tail = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+        cq.mask = *reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+        cq.cqes = reinterpret_cast<::io_uring_cqe*>(base + params.cq_off.cqes);
+    }
+
+    void setup_buffers()
+    {
+        buffer_ring_size = buffer_count * sizeof(::io_uring_buf);
+        buffer_ring = static_cast<::io_uring_buf*>(
+                    ::mmap(nullptr, buffer_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        if (buffer_ring == MAP_FAILED)
+        {
+            buffer_ring = nullptr;
+            throw_system_error(errno);
+        }
+
+        buffers_size = buffer_count * buffer_size;
+        buffers = static_cast<char*>(
+                    ::mmap(nullptr, buffers_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        if (buffers == MAP_FAILED)
+        {
+            buffers = nullptr;
+            throw_system_error(errno);
+        }
+
+        ::io_uring_buf_reg reg;
+        std::memset(&reg, 0, sizeof(reg));
+        reg.ring_addr = reinterpret_cast<std::uint64_t>(buffer_ring);
+        reg.ring_entries = buffer_count;
+        reg.bgid = buffer_group;
+
+        if (io_uring_register(ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) == -1)
+            throw_system_error(errno);
+
+        for (unsigned i = 0; i < buffer_count; i++)
+            recycle(i);
+    }
+
+    void probe()
+    {
+        static const unsigned op_count = 256;
+        std::vector<char> storage(sizeof(::io_uring_probe) + op_count * sizeof(::io_uring_probe_op), 0);
+
+        if (io_uring_register(ring_fd, IORING_REGISTER_PROBE, storage.data(), op_count) == -1)
+            return;
+
+        auto probe = reinterpret_cast<::io_uring_probe*>(storage.data());
+        auto ops = reinterpret_cast<::io_uring_probe_op*>(storage.data() + sizeof(::io_uring_probe));
+
+        multishot_reads = probe->last_op >= op_read_multishot &&
+                (ops[op_read_multishot].flags & IO_URING_OP_SUPPORTED);
+    }
+
+    void cleanup()
+    {
+        if (event_fd != -1)
+            ::close(event_fd);
+        if (sqes)
+            ::munmap(sqes, sqes_size);
+        if (ring)
+            ::munmap(ring, ring_size);
+        if (ring_fd != -1)
+            ::close(ring_fd);
+        if (buffers)
+            ::munmap(buffers, buffers_size);
+        if (buffer_ring)
+            ::munmap(buffer_ring, buffer_ring_size);
+    }
+
+    // Cancels everything in flight and waits for the kernel to let go
+    // of our buffers. Handlers are not invoked anymore.
+    void drain()
+    {
+        if (ring_fd == -1)
+            return;
+
+        auto sqe = next_sqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->cancel_flags = IORING_ASYNC_CANCEL_ALL | IORING_ASYNC_CANCEL_ANY;
+        sqe->user_data = ignored_token;
+
+        while (in_flight > 0)
+        {
+            if (submit(1) == -1 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                break;
+
+            unsigned head = *cq.head;
+            while (head != __atomic_load_n(cq.tail, __ATOMIC_ACQUIRE))
+            {
+                const auto& cqe = cq.cqes[head & cq.mask];
+                if (cqe.user_data != ignored_token && !(cqe.flags & IORING_CQE_F_MORE))
+                    in_flight--;
+                head++;
+            }
+            __atomic_store_n(cq.head, head, __ATOMIC_RELEASE);
+        }
+    }
+
+    void wake_up()
+    {
+        static const std::uint64_t value{1};
+        counters.system_calls++;
+        if (sizeof(value) != ::write(event_fd, &value, sizeof(value)))
+            throw std::system_error(errno, std::system_category());
+    }
+
+    // Executes task right away if called on the thread running the engine,
+    // and queues it for execution on that thread otherwise.
+    void dispatch(const std::function<void()>& task)
+    {
+        if (runner.load() == std::this_thread::get_id())
+            task();
+        else
+            post(task);
+    }
+
+    void run_tasks()
+    {
+        std::deque<std::function<void()>> current;
+        {
+            std::lock_guard<std::mutex> lg(guard);
+            std::swap(current, tasks);
+        }
+
+        for (const auto& task : current)
+            task();
+    }
+
+    // Returns the next free submission queue entry, submitting queued
+    // entries to make room if necessary.
+    ::io_uring_sqe* next_sqe()
+    {
+        if (sq.local_tail - __atomic_load_n(sq.head, __ATOMIC_ACQUIRE) >= sq.entries)
+            if (submit(0) == -1 || sq.local_tail - __atomic_load_n(sq.head, __ATOMIC_ACQUIRE) >= sq.entries)
+                throw std::system_error(EBUSY, std::system_category());
+
+        auto index = sq.local_tail & sq.mask;
+        auto sqe = &sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sq.array[index] = index;
+        sq.local_tail++;
+
+        return sqe;
+    }
+
+    // Hands all queued entries to the kernel, waiting for wait_for completions.
+    int submit(unsigned wait_for)
+    {
+        __atomic_store_n(sq.tail, sq.local_tail, __ATOMIC_RELEASE);
+        unsigned count = sq.local_tail - __atomic_load_n(sq.head, __ATOMIC_ACQUIRE);
+
+        if (count == 0 && wait_for == 0)
+            return 0;
+
+        counters.system_calls++;
+        return io_uring_enter(ring_fd, count, wait_for, wait_for > 0 ? IORING_ENTER_GETEVENTS : 0);
+    }
+
+    void arm_wake_up()
+    {
+        auto sqe = next_sqe();
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = event_fd;
+        sqe->addr = reinterpret_cast<std::uint64_t>(&wake_up_value);
+        sqe->len = sizeof(wake_up_value);
+        sqe->user_data = wake_up_token;
+        in_flight++;
+    }
+
+    // Queues the operation with the given id for submission.
+    void arm(std::uint64_t id)
+    {
+        const auto& op = operations.at(id);
+        auto sqe = next_sqe();
+        sqe->fd = op.fd;
+        sqe->user_data = id;
+        in_flight++;
+
+        if (op.polling)
+        {
+            sqe->opcode = IORING_OP_POLL_ADD;
+            sqe->poll32_events = op.kind == Operation::Kind::write ? POLLOUT : POLLIN;
+            return;
+        }
+
+        switch (op.kind)
+        {
+        case Operation::Kind::read:
+            // Buffers are selected by the kernel once data is available. A
+            // multishot read stays armed until end-of-file, an error or until
+            // the kernel runs out of buffers.
+            sqe->opcode = multishot_reads ? op_read_multishot : static_cast<std::uint8_t>(IORING_OP_READ);
+            sqe->off = static_cast<std::uint64_t>(-1);
+            sqe->flags = IOSQE_BUFFER_SELECT;
+            sqe->buf_group = buffer_group;
+            break;
+        case Operation::Kind::write:
+            sqe->opcode = IORING_OP_WRITEV;
+            sqe->off = static_cast<std::uint64_t>(-1);
+            sqe->addr = reinterpret_cast<std::uint64_t>(op.iov.data());
+            sqe->len = op.iov.size();
+            break;
+        case Operation::Kind::wait:
+            sqe->opcode = IORING_OP_POLL_ADD;
+            sqe->poll32_events = POLLIN;
+            break;
+        }
+    }
+
+    void submit_cancel(std::uint64_t id)
+    {
+        auto sqe = next_sqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = id;
+        sqe->user_data = ignored_token;
+    }
+
+    // Marks the operation as canceled. Its completions are swallowed from now on.
+    void abandon(std::uint64_t id)
+    {
+        operations[id].canceled = true;
+        submit_cancel(id);
+    }
+
+    // Hands a buffer back to the kernel.
+    void recycle(std::uint16_t bid)
+    {
+        auto& entry = buffer_ring[buffer_tail & (buffer_count - 1)];
+        entry.addr = reinterpret_cast<std::uint64_t>(buffers + bid * buffer_size);
+        entry.len = buffer_size;
+        entry.bid = bid;
+
+        buffer_tail++;
+
+        // The tail of the ring overlays the reserved field of the first entry.
+        __atomic_store_n(&buffer_ring[0].resv, buffer_tail, __ATOMIC_RELEASE);
+    }
+
+    void process_completions()
+    {
+        unsigned head = *cq.head;
+
+        while (head != __atomic_load_n(cq.tail, __ATOMIC_ACQUIRE))
+        {
+            // We hand the slot back to the kernel before processing the
+            // completion, as handlers might submit and wait themselves.
+            ::io_uring_cqe cqe = cq.cqes[head & cq.mask];
+            __atomic_store_n(cq.head, ++head, __ATOMIC_RELEASE);
+
+            complete(cqe);
+        }
+    }
+
+    void complete(const ::io_uring_cqe& cqe)
+    {
+        bool more = cqe.flags & IORING_CQE_F_MORE;
+
+        if (cqe.user_data == ignored_token)
+            return;
+
+        if (!more)
+            in_flight--;
+
+        if (cqe.user_data == wake_up_token)
+        {
+            arm_wake_up();
+            run_tasks();
+            return;
+        }
+
+        auto id = cqe.user_data;
+        auto it = operations.find(id);
+        if (it == operations.end())
+            return;
+
+        Operation& op = it->second;
+
+        if (op.canceled)
+        {
+            if (cqe.flags & IORING_CQE_F_BUFFER)
+                recycle(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+
+            if (more)
+                return;
+
+            if (op.kind == Operation::Kind::write)
+            {
+                std::size_t size = !op.polling && cqe.res > 0 ? cqe.res : 0;
+                auto writer = op.writer;
+                operations.erase(it);
+                writer(size, std::make_error_code(std::errc::operation_canceled));
+                return;
+            }
+
+            operations.erase(it);
+            return;
+        }
+
+        if (op.polling)
+        {
+            // Readiness has been signalled, or polling failed. Either way
+            // we retry, reporting errors from the actual operation.
+            op.polling = false;
+            arm(id);
+            return;
+        }
+
+        if (cqe.res == -EAGAIN || cqe.res == -EINTR)
+        {
+            // The fd has been switched to non-blocking mode behind our back.
+            op.polling = cqe.res == -EAGAIN;
+            arm(id);
+            return;
+        }
+
+        switch (op.kind)
+        {
+        case Operation::Kind::read:
+            complete_read(id, op, cqe, more);
+            break;
+        case Operation::Kind::write:
+            complete_write(id, op, cqe);
+            break;
+        case Operation::Kind::wait:
+            complete_wait(id, op, cqe);
+            break;
+        }
+    }
+
+    void complete_read(std::uint64_t id, Operation& op, const ::io_uring_cqe& cqe, bool more)
+    {
+        if (cqe.res > 0)
+        {
+            std::uint16_t bid = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+            counters.bytes_read += cqe.res;
+
+            // Copy the handler as it might cancel itself.
+            auto reader = op.reader;
+            reader(buffers + bid * buffer_size, cqe.res, std::error_code{});
+            recycle(bid);
+
+            if (more)
+                return;
+
+            auto it = operations.find(id);
+            if (it->second.canceled)
+                operations.erase(it);
+            else
+                arm(id);
+
+            return;
+        }
+
+        if (cqe.res == -ENOBUFS)
+        {
+            // All buffers have been consumed by completions we have processed
+            // already, and they have been recycled in the meantime.
+            arm(id);
+            return;
+        }
+
+        std::error_code e;
+        if (cqe.res < 0)
+            e = std::error_code(-cqe.res, std::system_category());
+
+        auto fd = op.fd;
+        auto reader = op.reader;
+        erase(id);
+
+        auto it = descriptors.find(fd);
+        it->second.reader = 0;
+        forget_if_idle(it);
+
+        reader(nullptr, 0, e);
+    }
+
+    void complete_write(std::uint64_t id, Operation& op, const ::io_uring_cqe& cqe)
+    {
+        std::error_code e;
+        if (cqe.res < 0)
+            e = std::error_code(-cqe.res, std::system_category());
+        else
+            counters.bytes_written += cqe.res;
+
+        auto fd = op.fd;
+        auto writer = op.writer;
+        erase(id);
+
+        auto it = descriptors.find(fd);
+        it->second.writes.pop_front();
+        if (!it->second.writes.empty())
+            arm(it->second.writes.front());
+        else
+            forget_if_idle(it);
+
+        writer(cqe.res > 0 ? cqe.res : 0, e);
+    }
+
+    void complete_wait(std::uint64_t id, Operation& op, const ::io_uring_cqe& cqe)
+    {
+        std::error_code e;
+        if (cqe.res < 0)
+            e = std::error_code(-cqe.res, std::system_category());
+
+        auto fd = op.fd;
+        auto waiter = op.waiter;
+        erase(id);
+
+        auto it = descriptors.find(fd);
+        auto& waiters = it->second.waiters;
+        waiters.erase(std::find(waiters.begin(), waiters.end(), id));
+        forget_if_idle(it);
+
+        waiter(e);
+    }
+
+    void erase(std::uint64_t id)
+    {
+        operations.erase(id);
+    }
+
+    void forget_if_idle(std::unordered_map<int, Descriptor>::iterator it)
+    {
+        if (it->second.reader == 0 && it->second.writes.empty() && it->second.waiters.empty())
+            descriptors.erase(it);
+    }
+
+    int ring_fd{-1};
+    void* ring{nullptr};
+    std::size_t ring_size{0};
+    ::io_uring_sqe* sqes{nullptr};
+    std::size_t sqes_size{0};
+
+    struct
+    {
+        unsigned* head;
+        unsigned* tail;
+        unsigned mask;
+        unsigned entries;
+        unsigned* array;
+        unsigned local_tail;
+    } sq;
+
+    struct
+    {
+        unsigned* head;
+        unsigned* tail;
+        unsigned mask;
+        ::io_uring_cqe* cqes;
+    } cq;
+
+    ::io_uring_buf* buffer_ring{nullptr};
+    std::size_t buffer_ring_size{0};
+    std::uint16_t buffer_tail{0};
+    char* buffers{nullptr};
+    std::size_t buffers_size{0};
+    bool multishot_reads{false};
+
+    int event_fd{-1};
+    std::uint64_t wake_up_value{0};
+
+    std::atomic<bool> stop_requested;
+    std::atomic<std::thread::id> runner;
+    impl::Counters counters;
+
+    std::mutex guard;
+    std::deque<std::function<void()>> tasks;
+
+    // Only ever accessed on the thread executing run().
+    std::uint64_t next_token{first_operation_token};
+    std::size_t in_flight{0};
+    std::unordered_map<std::uint64_t, Operation> operations;
+    std::unordered_map<int, Descriptor> descriptors;
+};
+}
+
+std::shared_ptr<core::posix::IoEngine> core::posix::linux::create_io_uring_engine()
+{
+    return std::make_shared<IoUringIoEngine>();
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Thomas Voß <thomas.voss@canonical.com>
+ */
+
+#ifndef CORE_POSIX_LINUX_IO_URING_ENGINE_H_
+#define CORE_POSIX_LINUX_IO_URING_ENGINE_H_
+
+#include <core/posix/io_engine.h>
+
+#include <memory>
+
+namespace core
+{
+namespace posix
+{
+namespace linux
+{
+/**
+ * @brief Creates an IoEngine based on io_uring.
+ *
+ * Reads are submitted as multishot reads into a ring of buffers provided to
+ * the kernel, falling back to re-armed single-shot reads on kernels without
+ * multishot read support.
+ *
+ * @throw std::system_error if io_uring or one of the required features is not available.
+ */
+std::shared_ptr<IoEngine> create_io_uring_engine();
+}
+}
+}
+
+#endif // CORE_POSIX_LINUX_IO_URING_ENGINE_H_
@@ -0,0 +1,98 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Thomas Voß <thomas.voss@canonical.com>
+ */
+
+#ifndef CORE_POSIX_LINUX_PIDFD_H_
+#define CORE_POSIX_LINUX_PIDFD_H_
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+// Older C libraries do not know about pidfds, so we talk to the kernel directly.
+// pidfd_open has the same number on all architectures.
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+
+#ifndef SYS_pidfd_send_signal
+#define SYS_pidfd_send_signal 424
+#endif
+
+namespace impl
+{
+// The idtype for waiting on a pidfd, P_PIDFD in recent C libraries.
+const int p_pidfd = 3;
+
+// Returns a file descriptor referring to the process identified by pid, or
+// -1 with errno set. The descriptor is close-on-exec, and becomes readable
+// once the process has terminated.
+inline int pidfd_open(pid_t pid)
+{
+    return ::syscall(SYS_pidfd_open, pid, 0);
+}
+
+// Sends signal to the process referred to by pidfd. Returns -1 with errno
+// set on error, and 0 otherwise. In contrast to kill, the signal cannot end
+// up with an unrelated process that recycled the pid.
+inline int pidfd_send_signal(int pidfd, int signal)
+{
+    return ::syscall(SYS_pidfd_send_signal, pidfd, signal, nullptr, 0);
+}
+
+// Sends signal accompanied by info to the process referred to by pidfd,
+// the equivalent of sigqueue. Returns -1 with errno set on error, and 0
+// otherwise.
+inline int pidfd_send_signal(int pidfd, int signal, ::siginfo_t& info)
+{
+    return ::syscall(SYS_pidfd_send_signal, pidfd, signal, &info, 0);
+}
+
+// Duplicates pidfd if valid, and opens a pidfd for pid otherwise. Returns -1
+// with errno set on error. The descriptor is close-on-exec.
+inline int pidfd_dup_or_open(int pidfd, pid_t pid)
+{
+    return pidfd != -1 ? ::fcntl(pidfd, F_DUPFD_CLOEXEC, 0) : pidfd_open(pid);
+}
+
+// Returns true if the child referred to by pidfd has been reaped already, by
+// whomever. Does not reap the child itself.
+inline bool pidfd_is_reaped(int pidfd)
+{
+    ::siginfo_t info;
+    return ::syscall(SYS_waitid, p_pidfd, pidfd, &info, WEXITED | WNOHANG | WNOWAIT, nullptr) == -1 &&
+            errno == ECHILD;
+}
+
+// Reaps the process referred to by pidfd if it has terminated, filling in
+// info and usage. Returns -1 with errno set on error, and 0 otherwise.
+// info.si_pid is 0 if the process has not terminated yet. The C library's
+// waitid does not hand out resource usage, but the system call does.
+inline int pidfd_try_reap(int pidfd, ::siginfo_t& info, ::rusage& usage)
+{
+    info.si_pid = 0;
+    return ::syscall(SYS_waitid, p_pidfd, pidfd, &info, WEXITED | WNOHANG, &usage);
+}
+}
+
+#endif // CORE_POSIX_LINUX_PIDFD_H_
@@ -0,0 +1,273 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Thomas Voß <thomas.voss@canonical.com>
+ */
+
+#include <core/posix/linux/proc/process_tree.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
+namespace
+{
+// Reads the parent of the process whose /proc entry is name from
+// <name>/stat. Returns false if the process is gone already.
+bool read_parent(int proc, const char* name, pid_t& parent)
+{
+    std::string path{name}; path += "/stat";
+
+    int fd = ::openat(proc, path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return false;
+
+    // The parent is the fourth field, the executable in front of it is
+    // limited to 16 characters. 256 bytes are plenty.
+    char buffer[256];
+    auto rc = ::read(fd, buffer, sizeof(buffer) - 1);
+    ::close(fd);
+
+    if (rc <= 0)
+        return false;
+
+    buffer[rc] = '\0';
+
+    // The executable might contain spaces and parentheses itself, so we
+    // look for the last closing parenthesis.
+    auto end = std::strrchr(buffer, ')');
+    if (!end || end[1] != ' ' || end[2] == '\0')
+        return false;
+
+    char* first = end + 3;
+    char* last = nullptr;
+    auto value = std::strtol(first, &last, 10);
+    if (last == first)
+        return false;
+
+    parent = static_cast<pid_t>(value);
+    return true;
+}
+
+bool is_pid(const char* name)
+{
+    if (*name == '\0')
+        return false;
+
+    for (; *name != '\0'; name++)
+        if (*name < '0' || *name > '9')
+            return false;
+
+    return true;
+}
+}
+
+namespace core
+{
+namespace posix
+{
+namespace linux
+{
+namespace proc
+{
+struct ProcessTree::Private
+{
+    std::unordered_map<pid_t, pid_t> parents;
+    std::unordered_map<pid_t, std::vector<pid_t>> children;
+};
+
+ProcessTree::ProcessTree(const std::shared_ptr<Private>& d) : d(d)
+{
+}
+
+ProcessTree ProcessTree::snapshot_or_throw()
+{
+    auto dir = ::opendir("/proc");
+    if (!dir)
+        throw std::system_error(errno, std::system_category());
+
+    std::shared_ptr<Private> d{new Private()};
+
+    try
+    {
+        while (true)
+        {
+            // readdir reports errors via errno only, and skipping a process
+            // that is gone already leaves a stale errno behind.
+            errno = 0;
+            auto entry = ::readdir(dir);
+            if (!entry)
+                break;
+
+            if (!is_pid(entry->d_name))
+                continue;
+
+            pid_t parent{-1};
+            if (!read_parent(::dirfd(dir), entry->d_name, parent))
+                continue;
+
+            pid_t pid = static_cast<pid_t>(std::atol(entry->d_name));
+            d->parents[pid] = parent;
+            d->children[parent].push_back(pid);
+        }
+    } catch(...)
+    {
+        ::closedir(dir);
+        throw;
+    }
+
+    auto error = errno;
+    ::closedir(dir);
+
+    if (error != 0)
+        throw std::system_error(error, std::system_category());
+
+    return ProcessTree{d};
+}
+
+std::size_t ProcessTree::size() const
+{
+    return d->parents.size();
+}
+
+bool ProcessTree::contains(pid_t pid) const
+{
+    return d->parents.count(pid) > 0;
+}
+
+pid_t ProcessTree::parent_of(pid_t pid) const
+{
+    auto it = d->parents.find(pid);
+    return it == d->parents.end() ? -1 : it->second;
+}
+
+const std::vector<pid_t>& ProcessTree::children_of(pid_t pid) const
+{
+    static const std::vector<pid_t> none;
+
+    auto it = d->children.find(pid);
+    return it == d->children.end() ? none : it->second;
+}
+
+std::vector<pid_t> ProcessTree::subtree_of(pid_t pid) const
+{
+    std::vector<pid_t> result;
+
+    if (!contains(pid))
+        return result;
+
+    // Breadth-first, the result doubles as the queue.
+    result.push_back(pid);
+    for (std::size_t i = 0; i < result.size(); i++)
+    {
+        const auto& children = children_of(result[i]);
+        result.insert(result.end(), children.begin(), children.end());
+    }
+
+    return result;
+}
+
+void kill_tree_or_throw(pid_t pid, Signal signal)
+{
+    std::error_code e;
+    kill_tree(pid, signal, e);
+
+    if (e)
+        throw std::system_error(e);
+}
+
+void kill_tree(pid_t pid, Signal signal, std::error_code& e) noexcept
+{
+    // Bounds the number of rescans for trees that keep on growing faster
+    // than we are able to stop them.
+    static const int max_rounds = 16;
+
+    e.clear();
+
+    auto remember = [&e](int error)
+    {
+        if (!e && error != ESRCH)
+            e = std::error_code(error, std::system_category());
+    };
+
+    try
+    {
+        const pid_t self = ::getpid();
+
+        std::vector<pid_t> members;
+        std::unordered_set<pid_t> seen;
+        bool includes_self = false;
+
+        for (int round = 0; round < max_rounds; round++)
+        {
+            auto tree = ProcessTree::snapshot_or_throw();
+
+            if (round == 0 && !tree.contains(pid))
+            {
+                e = std::error_code(ESRCH, std::system_category());
+                return;
+            }
+
+            bool grew = false;
+            for (auto member : tree.subtree_of(pid))
+            {
+                if (!seen.insert(member).second)
+                    continue;
+
+                grew = true;
+
+                if (member == self)
+                {
+                    includes_self = true;
+                    continue;
+                }
+
+                members.push_back(member);
+                ::kill(member, SIGSTOP);
+            }
+
+            if (!grew)
+                break;
+        }
+
+        for (auto member : members)
+            if (::kill(member, static_cast<int>(signal)) == -1)
+                remember(errno);
+
+        if (signal != Signal::sig_kill && signal != Signal::sig_stop)
+            for (auto member : members)
+                ::kill(member, SIGCONT);
+
+        if (includes_self && ::kill(self, static_cast<int>(signal)) == -1)
+            remember(errno);
+    } catch(const std::system_error& se)
+    {
+        e = se.code();
+    } catch(...)
+    {
+        e = std::make_error_code(std::errc::not_enough_memory);
+    }
+}
+}
+}
+}
+}
@@ -0,0 +1,339 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Thomas Voß <thomas.voss@canonical.com>
+ */
+
+#include <core/posix/linux/zero_copy.h>
+
+#include <core/posix/child_process.h>
+
+#include <algorithm>
+#include <ostream>
+#include <vector>
+
+#include <cstdio>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+namespace
+{
+// Larger pipes mean fewer wakeups of both the child and us when feeding
+// big inputs. Growing the pipe is best-effort only, the kernel caps the
+// size at /proc/sys/fs/pipe-max-size for unprivileged processes.
+const int preferred_pipe_size = 1 << 20;
+
+int stdin_of(core::posix::ChildProcess& child, std::error_code& e)
+{
+    // Make sure that whatever has been written via cin() reaches the pipe
+    // before the data we are about to feed.
+    child.cin().flush();
+
+    int fd = child.native_handle(core::posix::StandardStream::stdin);
+
+    if (fd == -1)
+        e = std::error_code(EBADF, std::system_category());
+    else
+        ::fcntl(fd, F_SETPIPE_SZ, preferred_pipe_size);
+
+    return fd;
+}
+
+std::size_t copy_to_pipe(int pipe, int fd, off_t offset, std::size_t size, std::error_code& e)
+{
+    std::vector<char> buffer(std::min<std::size_t>(size, preferred_pipe_size));
+    std::size_t result{0};
+
+    while (result < size)
+    {
+        auto rc = ::pread(fd, buffer.data(), std::min(buffer.size(), size - result), offset);
+
+        if (rc == -1 && errno == EINTR)
+            continue;
+
+        if (rc == -1)
+        {
+            e = std::error_code(errno, std::system_category());
+            break;
+        }
+
+        if (rc == 0)
+            break;
+
+        for (ssize_t written = 0; written < rc;)
+        {
+            auto wc = ::write(pipe, buffer.data() + written, rc - written);
+
+            if (wc == -1 && errno == EINTR)
+                continue;
+
+            if (wc == -1)
+            {
+                e = std::error_code(errno, std::system_category());
+                return result + written;
+            }
+
+            written += wc;
+        }
+
+        offset += rc;
+        result += rc;
+    }
+
+    return result;
+}
+}
+
+namespace core
+{
+namespace posix
+{
+namespace linux
+{
+std::size_t vmsplice_to_stdin(ChildProcess& child,
+                              const void* data,
+                              std::size_t size,
+                              std::error_code& e) noexcept(true)
+{
+    int pipe = stdin_of(child, e);
+
+    if (e)
+        return 0;
+
+    ::iovec iov{const_cast<void*>(data), size};
+    std::size_t result{0};
+
+    while (iov.iov_len > 0)
+    {
+        auto rc = ::vmsplice(pipe, &iov, 1, 0);
+
+        if (rc == -1 && errno == EINTR)
+            continue;
+
+        if (rc == -1)
+        {
+            e = std::error_code(errno, std::system_category());
+            break;
+        }
+
+        iov.iov_base = static_cast<char*>(iov.iov_base) + rc;
+        iov.iov_len -= rc;
+        result += rc;
+    }
+
+    return result;
+}
+
+std::size_t vmsplice_to_stdin_or_throw(ChildProcess& child,
+                                       const void* data,
+                                       std::size_t size)
+{
+    std::error_code e;
+    auto result = vmsplice_to_stdin(child, data, size, e);
+
+    if (e)
+        throw std::system_error(e);
+
+    return result;
+}
+
+std::size_t splice_to_stdin(ChildProcess& child,
+                            int fd,
+                            off_t offset,
+                            std::size_t size,
+                            std::error_code& e) noexcept(true)
+{
+    int pipe = stdin_of(child, e);
+
+    if (e)
+        return 0;
+
+    std::size_t result{0};
+
+    while (result < size)
+    {
+        auto rc = ::splice(fd, &offset, pipe, nullptr, size - result, SPLICE_F_MOVE | SPLICE_F_MORE);
+
+        if (rc == -1 && errno == EINTR)
+            continue;
+
+        if (rc == -1 && errno == EINVAL)
+            break; // File system does not support splicing, fall back below.
+
+        if (rc == -1)
+        {
+            e = std::error_code(errno, std::system_category());
+            return result;
+        }
+
+        if (rc == 0)
+            return result;
+
+        result += rc;
+    }
+
+    while (result < size)
+    {
+        auto rc = ::sendfile(pipe, fd, &offset, size - result);
+
+        if (rc == -1 && errno == EINTR)
+            continue;
+
+        if (rc == -1 && (errno == EINVAL || errno == ENOSYS))
+            break; // Neither splice nor sendfile work, copy through user space.
+
+        if (rc == -1)
+        {
+            e = std::error_code(errno, std::system_category());
+            return result;
+        }
+
+        if (rc == 0)
+            return result;
+
+        result += rc;
+    }
+
+    if (result < size)
+        result += copy_to_pipe(pipe, fd, offset, size - result, e);
+
+    return result;
+}
+
+std::size_t splice_to_stdin_or_throw(ChildProcess& child,
+                                     int fd,
+                                     off_t offset,
+                                     std::size_t size)
+{
+    std::error_code e;
+    auto result = splice_to_stdin(child, fd, offset, size, e);
+
+    if (e)
+        throw std::system_error(e);
+
+    return result;
+}
+
+struct SealedMemoryFile::Private
+{
+    ~Private()
+    {
+        ::close(fd);
+    }
+
+    int fd;
+    std::size_t size;
+};
+
+SealedMemoryFile SealedMemoryFile::create_or_throw(const std::string& name,
+                                                   const void* data,
+                                                   std::size_t size)
+{
+    int fd = ::syscall(SYS_memfd_create, name.c_str(), MFD_CLOEXEC | MFD_ALLOW_SEALING);
+
+    if (fd == -1)
+        throw std::system_error(errno, std::system_category());
+
+    // Hand over ownership of the fd right away to make sure
+    // that it is cleaned up if anything below throws.
+    SealedMemoryFile result{fd, size};
+
+    if (::ftruncate(fd, size) == -1)
+        throw std::system_error(errno, std::system_category());
+
+    auto p = static_cast<const char*>(data);
+    for (std::size_t written = 0; written < size;)
+    {
+        auto rc = ::pwrite(fd, p + written, size - written, written);
+
+        if (rc == -1 && errno == EINTR)
+            continue;
+
+        if (rc == -1)
+            throw std::system_error(errno, std::system_category());
+
+        written += rc;
+    }
+
+    static const int seals = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL;
+    if (::fcntl(fd, F_ADD_SEALS, seals) == -1)
+        throw std::system_error(errno, std::system_category());
+
+    return result;
+}
+
+SealedMemoryFile::SealedMemoryFile(int fd, std::size_t size)
+{
+    Private* p{nullptr};
+
+    try
+    {
+        p = new Private{fd, size};
+    } catch(...)
+    {
+        // We own fd from the start, but Private does not yet.
+        ::close(fd);
+        throw;
+    }
+
+    // Deletes p, and thus closes fd, if allocating the control block throws.
+    d.reset(p);
+}
+
+int SealedMemoryFile::native_handle() const
+{
+    return d->fd;
+}
+
+std::size_t SealedMemoryFile::size() const
+{
+    return d->size;
+}
+
+std::function<void()> SealedMemoryFile::redirect_to_stdin() const
+{
+    auto sd = d;
+    return [sd]()
+    {
+        // Reopening via procfs gives us a new open file description, and
+        // thus an offset that is not shared with any other child. We run
+        // in a child forked from a possibly multithreaded parent, and must
+        // not allocate.
+        char path[32];
+        std::snprintf(path, sizeof(path), "/proc/self/fd/%d", sd->fd);
+        int fd = ::open(path, O_RDONLY);
+
+        if (fd == -1)
+        {
+            fd = sd->fd;
+            ::lseek(fd, 0, SEEK_SET);
+        }
+
+        if (::dup2(fd, STDIN_FILENO) == -1)
+            throw std::system_error(errno, std::system_category());
+
+        if (fd != sd->fd)
+            ::close(fd);
+    };
+}
+}
+}
+}
@@ -20,45 +20,119 @@
 
 #include <core/posix/signal.h>
 
+#include "linux/pidfd.h"
+
+#include <poll.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <string>
+
+namespace
+{
+// Reads the start time of pid from /proc/<pid>/stat, returns -1 on error.
+long int start_time_of(pid_t pid)
+{
+    std::stringstream ss; ss << "/proc/" << pid << "/stat";
+    std::ifstream in(ss.str());
+
+    std::string line;
+    if (!std::getline(in, line))
+        return -1;
+
+    // The executable might contain spaces and parentheses itself.
+    auto end = line.rfind(')');
+    if (end == std::string::npos)
+        return -1;
+
+    // The start time is the 22nd field, the 20th one after the executable.
+    std::istringstream fields(line.substr(end + 1));
+    std::string field;
+    for (int i = 0; i < 19; i++)
+        fields >> field;
+
+    long int start_time{-1};
+    if (!(fields >> start_time))
+        return -1;
+
+    return start_time;
+}
+}
 
 namespace core
 {
 namespace posix
 {
 
-struct Process::Private
+Process Process::open_or_throw(pid_t pid)
+{
+    if (pid <= 0)
+        throw std::system_error(EINVAL, std::system_category());
+
+    int pidfd = impl::pidfd_open(pid);
+    if (pidfd == -1)
+        throw std::system_error(errno, std::system_category());
+
+    auto start_time = start_time_of(pid);
+
+    // If the process is still alive after we have read its start time, the
+    // pid has not been recycled in between, and the start time belongs to
+    // the process the pidfd refers to. Lacking the permission to signal the
+    // process implies that it exists.
+    if (start_time == -1 || (impl::pidfd_send_signal(pidfd, 0) == -1 && errno != EPERM))
+    {
+        ::close(pidfd);
+        throw std::system_error(ESRCH, std::system_category());
+    }
+
+    return Process(pid, pidfd, start_time);
+}
+
+Process Process::open_or_throw(pid_t pid, long int start_time)
 {
-    pid_t pid;
-};
+    auto process = open_or_throw(pid);
+
+    if (process.start_time() != start_time)
+        throw std::system_error(ESRCH, std::system_category());
+
+    return process;
+}
 
 Process Process::invalid()
 {
     static const pid_t invalid_pid = 0;
     Process p(invalid_pid);
-    p.d->pid = -1;
+    p.process_id = -1;
 
     return p;
 }
 
 Process::Process(pid_t pid)
     : Signalable(pid),
-      d(new Private{pid})
+      process_id(pid),
+      process_start_time(-1)
 {
     if (pid < 0)
         throw std::runtime_error("Cannot construct instance for invalid pid.");
 }
 
+Process::Process(pid_t pid, int pidfd, long int start_time)
+    : Signalable(pid, pidfd),
+      process_id(pid),
+      process_start_time(start_time)
+{
+}
+
 Process::~Process() noexcept
 {
 }
 
 pid_t Process::pid() const
 {
-    return d->pid;
+    return process_id;
 }
 
 ProcessGroup Process::process_group_or_throw() const
@@ -82,5 +156,26 @@ ProcessGroup Process::process_group(std::error_code& se) const noexcept(true)
 
     return ProcessGroup(pgid);
 }
+
+long int Process::start_time() const
+{
+    return process_start_time;
+}
+
+bool Process::has_terminated_or_throw() const
+{
+    if (pidfd() == -1)
+        throw std::logic_error("Process: Termination can only be observed for processes with a pidfd.");
+
+    ::pollfd fd{pidfd(), POLLIN, 0};
+
+    int rc{-1};
+    while ((rc = ::poll(&fd, 1, 0)) == -1 && errno == EINTR);
+
+    if (rc == -1)
+        throw std::system_error(errno, std::system_category());
+
+    return rc == 1 && (fd.revents & POLLIN);
+}
 }
 }
@@ -18,24 +18,119 @@
 
 #include <core/posix/process_group.h>
 
+#include <core/posix/process.h>
+
+#include "known_children.h"
+#include "wait_support.h"
+
+#include <cerrno>
+#include <system_error>
+
+#include <signal.h>
+
+#include <sys/wait.h>
+
+namespace
+{
+// Waits for a member of group id to change state. Returns false with errno set on error.
+bool wait_for_member(pid_t id, int options, core::posix::ProcessGroup::Change& change)
+{
+    ::siginfo_t info;
+    info.si_pid = 0;
+
+    while (::waitid(P_PGID, id, &info, options) == -1)
+    {
+        if (errno != EINTR)
+            return false;
+    }
+
+    change.pid = info.si_pid;
+    change.result = impl::result_from_siginfo(info);
+
+    if (info.si_pid == 0)
+        change.result.status = core::posix::wait::Result::Status::no_state_change;
+
+    // The member might have been detached from its last ChildProcess instance.
+    if (change.result.status == core::posix::wait::Result::Status::exited ||
+        change.result.status == core::posix::wait::Result::Status::signaled)
+        impl::KnownChildren::instance().forget(info.si_pid);
+
+    return true;
+}
+}
+
 namespace core
 {
 namespace posix
 {
-struct ProcessGroup::Private
+ProcessGroup ProcessGroup::led_by(const Process& leader)
 {
-    pid_t id;
-};
+    return ProcessGroup(leader.pid());
+}
 
 pid_t ProcessGroup::id() const
 {
-    return d->id;
+    return group_id;
+}
+
+ProcessGroup::Change ProcessGroup::wait_for(const wait::Flags& flags)
+{
+    // waitid spells the flags differently, and needs to be told to report terminations.
+    int options = WEXITED;
+    auto f = static_cast<std::uint8_t>(flags);
+    if (f & WUNTRACED)
+        options |= WSTOPPED;
+    if (f & WCONTINUED)
+        options |= WCONTINUED;
+    if (f & WNOHANG)
+        options |= WNOHANG;
+
+    Change change;
+    if (!wait_for_member(group_id, options, change))
+        throw std::system_error(errno, std::system_category());
+
+    return change;
+}
+
+std::vector<ProcessGroup::Change> ProcessGroup::wait_all()
+{
+    std::vector<Change> changes;
+    Change change;
+
+    while (wait_for_member(group_id, WEXITED, change))
+        changes.push_back(change);
+
+    // We are done once no members are left.
+    if (errno != ECHILD)
+        throw std::system_error(errno, std::system_category());
+
+    return changes;
 }
 
 ProcessGroup::ProcessGroup(pid_t id)
     : Signalable(-id), // We rely on ::kill to deliver signals, thus negate the id (see man 2 kill).
-      d(new Private{id})
+      group_id(id)
+{
+}
+
+Grouping Grouping::inherit()
+{
+    return Grouping{Kind::inherit, 0};
+}
+
+Grouping Grouping::new_process_group()
+{
+    return Grouping{Kind::new_process_group, 0};
+}
+
+Grouping Grouping::join(const ProcessGroup& group)
+{
+    return Grouping{Kind::join_process_group, group.id()};
+}
+
+Grouping Grouping::new_session()
 {
+    return Grouping{Kind::new_session, 0};
 }
 }
 }
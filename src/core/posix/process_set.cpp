@@ -0,0 +1,148 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Thomas Voß <thomas.voss@canonical.com>
+ */
+
+#include <core/posix/process_set.h>
+
+#include "linux/pidfd.h"
+
+#include <algorithm>
+#include <thread>
+
+#include <signal.h>
+#include <unistd.h>
+
+namespace core
+{
+namespace posix
+{
+struct ProcessSet::Private
+{
+    struct Member
+    {
+        pid_t pid;
+        int pidfd;
+    };
+
+    ~Private()
+    {
+        for (const auto& member : members)
+            if (member.pidfd != -1)
+                ::close(member.pidfd);
+    }
+
+    // Signals the members in [begin, end), recording errors in errors.
+    void signal_range(Signal signal, std::size_t begin, std::size_t end, std::vector<std::error_code>& errors) const
+    {
+        for (std::size_t i = begin; i < end; i++)
+        {
+            const auto& member = members[i];
+
+            auto result = member.pidfd != -1 ?
+                        impl::pidfd_send_signal(member.pidfd, static_cast<int>(signal)) :
+                        ::kill(member.pid, static_cast<int>(signal));
+
+            if (result == -1)
+                errors[i] = std::error_code(errno, std::system_category());
+        }
+    }
+
+    std::vector<Member> members;
+};
+
+ProcessSet::ProcessSet() : d(new Private())
+{
+}
+
+std::size_t ProcessSet::add(const Process& process)
+{
+    // Processes with a pidfd already might have recycled their pid.
+    int pidfd = impl::pidfd_dup_or_open(process.pidfd(), process.pid());
+
+    try
+    {
+        d->members.push_back(Private::Member{process.pid(), pidfd});
+    } catch(...)
+    {
+        if (pidfd != -1)
+            ::close(pidfd);
+        throw;
+    }
+
+    return d->members.size() - 1;
+}
+
+std::size_t ProcessSet::size() const
+{
+    return d->members.size();
+}
+
+std::vector<std::error_code> ProcessSet::signal_all(Signal signal) const
+{
+    std::vector<std::error_code> errors(d->members.size());
+    d->signal_range(signal, 0, d->members.size(), errors);
+
+    return errors;
+}
+
+std::vector<std::error_code> ProcessSet::signal_all(Signal signal, std::size_t thread_count) const
+{
+    if (thread_count == 0)
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+    thread_count = std::min(thread_count, d->members.size());
+
+    if (thread_count <= 1)
+        return signal_all(signal);
+
+    std::vector<std::error_code> errors(d->members.size());
+
+    // Joins the workers started so far on all paths, as destroying a
+    // joinable thread terminates, e.g., if starting a further one throws.
+    struct Workers
+    {
+        ~Workers()
+        {
+            for (auto& thread : threads)
+                thread.join();
+        }
+
+        std::vector<std::thread> threads;
+    };
+
+    {
+        Workers workers;
+
+        // The calling thread takes care of the first chunk.
+        auto chunk = (d->members.size() + thread_count - 1) / thread_count;
+        for (std::size_t begin = chunk; begin < d->members.size(); begin += chunk)
+        {
+            auto end = std::min(begin + chunk, d->members.size());
+            workers.threads.emplace_back([this, signal, begin, end, &errors]()
+            {
+                d->signal_range(signal, begin, end, errors);
+            });
+        }
+
+        d->signal_range(signal, 0, chunk, errors);
+    }
+
+    // The workers are done with errors by now.
+    return errors;
+}
+}
+}
@@ -26,6 +26,13 @@
 #include <unistd.h>
 
 #include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 namespace impl
 {
@@ -39,6 +46,176 @@ void set_process_signal_mask(::sigset_t* new_mask, ::sigset_t* old_mask)
     ::sigprocmask(SIG_BLOCK, new_mask, old_mask);
 }
 
+// The signals of a trap, shared with tasks posted to dispatchers such
+// that they stay valid even if the trap is gone by the time a task runs.
+struct Emitter
+{
+    void emit(const core::posix::SignalInfo& info)
+    {
+        on_signal_raised(info.signal);
+        on_signal_raised_with_info(info);
+    }
+
+    core::Signal<core::posix::Signal> on_signal_raised;
+    core::Signal<core::posix::SignalInfo> on_signal_raised_with_info;
+};
+
+// Relays the signals routed to it via a dispatcher, one at a time and in
+// order of arrival if requested, even if the dispatcher runs tasks
+// concurrently.
+class Route : public std::enable_shared_from_this<Route>
+{
+public:
+    Route(const core::posix::Dispatcher& dispatcher,
+          core::posix::SignalTrap::Ordering ordering,
+          const std::shared_ptr<Emitter>& emitter)
+        : dispatcher(dispatcher),
+          ordering(ordering),
+          emitter(emitter)
+    {
+    }
+
+    void post(const core::posix::SignalInfo& info)
+    {
+        auto emitter = this->emitter;
+
+        if (ordering == core::posix::SignalTrap::Ordering::unordered)
+        {
+            dispatcher([emitter, info]() { emitter->emit(info); });
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lg(guard);
+            queue.push_back(info);
+
+            if (scheduled)
+                return;
+
+            scheduled = true;
+        }
+
+        auto self = shared_from_this();
+        dispatcher([self]() { self->drain(); });
+    }
+
+private:
+    void drain()
+    {
+        for (;;)
+        {
+            core::posix::SignalInfo info;
+
+            {
+                std::lock_guard<std::mutex> lg(guard);
+
+                if (queue.empty())
+                {
+                    scheduled = false;
+                    return;
+                }
+
+                info = queue.front();
+                queue.pop_front();
+            }
+
+            emitter->emit(info);
+        }
+    }
+
+    core::posix::Dispatcher dispatcher;
+    core::posix::SignalTrap::Ordering ordering;
+    std::shared_ptr<Emitter> emitter;
+
+    std::mutex guard;
+    std::deque<core::posix::SignalInfo> queue;
+    bool scheduled{false};
+};
+
+// Executes tasks on a fixed number of threads, until the last copy of
+// the dispatcher referring to the pool is gone.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(std::size_t thread_count) : state(std::make_shared<State>())
+    {
+        for (std::size_t i = 0; i < thread_count; i++)
+        {
+            auto state = this->state;
+            threads.emplace_back([state]() { run(state); });
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lg(state->guard);
+            state->stopped = true;
+        }
+
+        state->wakeup.notify_all();
+
+        for (auto& thread : threads)
+        {
+            // The last reference to the pool might be dropped by one of our
+            // tasks. The thread then outlives us, but not the state it shares.
+            if (thread.get_id() == std::this_thread::get_id())
+                thread.detach();
+            else
+                thread.join();
+        }
+    }
+
+    void post(const std::function<void()>& task)
+    {
+        {
+            std::lock_guard<std::mutex> lg(state->guard);
+            state->tasks.push_back(task);
+        }
+
+        state->wakeup.notify_one();
+    }
+
+private:
+    struct State
+    {
+        std::mutex guard;
+        std::condition_variable wakeup;
+        std::deque<std::function<void()>> tasks;
+        bool stopped{false};
+    };
+
+    static void run(const std::shared_ptr<State>& state)
+    {
+        for (;;)
+        {
+            std::function<void()> task;
+
+            {
+                std::unique_lock<std::mutex> ul(state->guard);
+                state->wakeup.wait(ul, [&state]() { return state->stopped || !state->tasks.empty(); });
+
+                if (state->stopped)
+                    return;
+
+                task = std::move(state->tasks.front());
+                state->tasks.pop_front();
+            }
+
+            try
+            {
+                task();
+            } catch(...)
+            {
+                // Exceptions must not escape the pool's threads.
+            }
+        }
+    }
+
+    std::shared_ptr<State> state;
+    std::vector<std::thread> threads;
+};
+
 class SignalTrap : public core::posix::SignalTrap
 {
 public:
@@ -57,7 +234,9 @@ public:
     SignalTrap(Scope scope, std::initializer_list<core::posix::Signal> blocked_signals)
         : scope(scope),
           state(State::not_running),
-          event_fd(::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
+          event_fd(::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+          signal_fd(-1),
+          emitter(std::make_shared<Emitter>())
     {
         if (event_fd == -1)
             throw std::system_error(errno, std::system_category());
@@ -76,20 +255,25 @@ public:
             set_thread_signal_mask(&blocked_signals_mask, &old_signals_mask);
             break;
         }
+
+        // The signal fd is created up front, such that it can be handed
+        // out to external event loops.
+        signal_fd = ::signalfd(-1, &blocked_signals_mask, SFD_CLOEXEC | SFD_NONBLOCK);
+
+        if (signal_fd == -1)
+        {
+            std::error_code ec(errno, std::system_category());
+            restore_signal_mask();
+            ::close(event_fd);
+            throw std::system_error(ec);
+        }
     }
 
     ~SignalTrap()
     {
-        switch (scope)
-        {
-        case Scope::process:
-            set_process_signal_mask(&old_signals_mask, nullptr);
-            break;
-        case Scope::thread:
-            set_thread_signal_mask(&old_signals_mask, nullptr);
-            break;
-        }
+        restore_signal_mask();
 
+        ::close(signal_fd);
         ::close(event_fd);
     }
 
@@ -103,35 +287,16 @@ public:
         static constexpr int signal_fd_idx = 0;
         static constexpr int event_fd_idx = 1;
 
-        static constexpr int signal_info_buffer_size = 5;
-
         if (state.load() == State::running)
             throw std::runtime_error("SignalTrap::run can only be run once.");
 
         state.store(State::running);
 
-        // Make sure we clean up the signal fd whenever
-        // we leave the scope of run.
-        struct Scope
-        {
-            ~Scope()
-            {
-                if (signal_fd != -1)
-                    ::close(signal_fd);
-            }
-
-            int signal_fd;
-        } scope{::signalfd(-1, &blocked_signals_mask, SFD_CLOEXEC | SFD_NONBLOCK)};
-
-        if (scope.signal_fd == -1)
-            throw std::system_error(errno, std::system_category());
-
         pollfd fds[2];
-        signalfd_siginfo signal_info[signal_info_buffer_size];
 
         for (;;)
         {
-            fds[signal_fd_idx] = {scope.signal_fd, POLLIN, 0};
+            fds[signal_fd_idx] = {signal_fd, POLLIN, 0};
             fds[event_fd_idx] = {event_fd, POLLIN, 0};
 
             auto rc = ::poll(fds, 2, -1);
@@ -149,17 +314,10 @@ public:
 
             if (fds[signal_fd_idx].revents & POLLIN)
             {
-                auto result = ::read(scope.signal_fd, signal_info, sizeof(signal_info));
-
-                for (uint i = 0; i < result / sizeof(signalfd_siginfo); i++)
-                {
-                    if (has(static_cast<core::posix::Signal>(signal_info[i].ssi_signo)))
-                    {
-                        on_signal_raised(
-                                    static_cast<core::posix::Signal>(
-                                        signal_info[i].ssi_signo));
-                    }
-                }
+                // Errors are transient here, e.g., another thread
+                // dispatching concurrently, and we just poll again.
+                std::error_code ec;
+                dispatch_pending(ec);
             }
 
             if (fds[event_fd_idx].revents & POLLIN)
@@ -177,6 +335,22 @@ public:
         state.store(State::not_running);
     }
 
+    int native_handle() const override
+    {
+        return signal_fd;
+    }
+
+    std::size_t dispatch_pending() override
+    {
+        std::error_code ec;
+        auto count = dispatch_pending(ec);
+
+        if (ec)
+            throw std::system_error(ec);
+
+        return count;
+    }
+
     void stop() override
     {
         static const std::int64_t value = {1};
@@ -186,19 +360,131 @@ public:
 
     core::Signal<core::posix::Signal>& signal_raised() override
     {
-        return on_signal_raised;
+        return emitter->on_signal_raised;
+    }
+
+    core::Signal<core::posix::SignalInfo>& signal_raised_with_info() override
+    {
+        return emitter->on_signal_raised_with_info;
+    }
+
+    void dispatch_via(core::posix::Signal signal,
+                      const core::posix::Dispatcher& dispatcher,
+                      Ordering ordering) override
+    {
+        std::lock_guard<std::mutex> lg(routes_guard);
+
+        if (!dispatcher)
+        {
+            routes.erase(static_cast<int>(signal));
+            return;
+        }
+
+        routes[static_cast<int>(signal)] = std::make_shared<Route>(dispatcher, ordering, emitter);
     }
 
 private:
+    std::size_t dispatch_pending(std::error_code& ec)
+    {
+        // Large enough to drain a storm of signals with a few reads.
+        static constexpr int signal_info_buffer_size = 64;
+        signalfd_siginfo signal_info[signal_info_buffer_size];
+
+        std::size_t count{0};
+
+        for (;;)
+        {
+            auto result = ::read(signal_fd, signal_info, sizeof(signal_info));
+
+            if (result == -1)
+            {
+                if (errno == EINTR)
+                    continue;
+
+                if (errno != EAGAIN)
+                    ec = std::error_code(errno, std::system_category());
+
+                return count;
+            }
+
+            for (uint i = 0; i < result / sizeof(signalfd_siginfo); i++)
+            {
+                if (has(static_cast<core::posix::Signal>(signal_info[i].ssi_signo)))
+                {
+                    core::posix::SignalInfo info;
+                    info.signal = static_cast<core::posix::Signal>(signal_info[i].ssi_signo);
+                    info.code = signal_info[i].ssi_code;
+                    info.sender_pid = static_cast<pid_t>(signal_info[i].ssi_pid);
+                    info.sender_uid = static_cast<uid_t>(signal_info[i].ssi_uid);
+                    info.status = signal_info[i].ssi_status;
+                    info.value = signal_info[i].ssi_int;
+
+                    if (auto route = route_for(info.signal))
+                        route->post(info);
+                    else
+                        emitter->emit(info);
+
+                    count++;
+                }
+            }
+        }
+    }
+
+    std::shared_ptr<Route> route_for(core::posix::Signal signal)
+    {
+        std::lock_guard<std::mutex> lg(routes_guard);
+
+        auto it = routes.find(static_cast<int>(signal));
+        return it == routes.end() ? std::shared_ptr<Route>{} : it->second;
+    }
+
+    void restore_signal_mask()
+    {
+        switch (scope)
+        {
+        case Scope::process:
+            set_process_signal_mask(&old_signals_mask, nullptr);
+            break;
+        case Scope::thread:
+            set_thread_signal_mask(&old_signals_mask, nullptr);
+            break;
+        }
+    }
+
     Scope scope;
     std::atomic<State> state;
     int event_fd;
-    core::Signal<core::posix::Signal> on_signal_raised;
+    int signal_fd;
+    std::shared_ptr<Emitter> emitter;
+    std::mutex routes_guard;
+    std::unordered_map<int, std::shared_ptr<Route>> routes;
     ::sigset_t old_signals_mask;
     ::sigset_t blocked_signals_mask;
 };
 }
 
+core::posix::Signal core::posix::realtime_signal(int n)
+{
+    if (n < 0 || n > SIGRTMAX - SIGRTMIN)
+        throw std::out_of_range("core::posix::realtime_signal: n exceeds the range of realtime signals.");
+
+    return static_cast<core::posix::Signal>(SIGRTMIN + n);
+}
+
+core::posix::Dispatcher core::posix::thread_pool_dispatcher(std::size_t thread_count)
+{
+    if (thread_count == 0)
+        throw std::invalid_argument("core::posix::thread_pool_dispatcher: thread_count must not be 0.");
+
+    auto pool = std::make_shared<impl::ThreadPool>(thread_count);
+    return [pool](const std::function<void()>& task) { pool->post(task); };
+}
+
+bool core::posix::is_realtime(core::posix::Signal signal)
+{
+    return static_cast<int>(signal) >= SIGRTMIN && static_cast<int>(signal) <= SIGRTMAX;
+}
+
 std::shared_ptr<core::posix::SignalTrap> core::posix::trap_signals_for_process(
         std::initializer_list<core::posix::Signal> blocked_signals)
 {
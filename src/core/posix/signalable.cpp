@@ -18,22 +18,72 @@
 
 #include <core/posix/signalable.h>
 
+#include "linux/pidfd.h"
+
+#include <cstring>
+
 namespace core
 {
 namespace posix
 {
+// Only allocated for signalable objects owning a pidfd, which has to be
+// closed once the last copy is gone.
 struct Signalable::Private
 {
-    pid_t pid;
+    ~Private()
+    {
+        ::close(pidfd);
+    }
+
+    int pidfd;
 };
 
-Signalable::Signalable(pid_t pid) : d(new Private{pid})
+namespace
+{
+int send(pid_t pid, int pidfd, Signal signal)
+{
+    return pidfd != -1 ?
+                impl::pidfd_send_signal(pidfd, static_cast<int>(signal)) :
+                ::kill(pid, static_cast<int>(signal));
+}
+
+int queue(pid_t pid, int pidfd, Signal signal, int value)
+{
+    ::sigval payload; payload.sival_int = value;
+
+    if (pidfd == -1)
+        return ::sigqueue(pid, static_cast<int>(signal), payload);
+
+    // Mirrors what sigqueue hands to the kernel.
+    ::siginfo_t info; std::memset(&info, 0, sizeof(info));
+    info.si_signo = static_cast<int>(signal);
+    info.si_code = SI_QUEUE;
+    info.si_pid = ::getpid();
+    info.si_uid = ::getuid();
+    info.si_value = payload;
+
+    return impl::pidfd_send_signal(pidfd, static_cast<int>(signal), info);
+}
+}
+
+Signalable::Signalable(pid_t pid) : target(pid)
+{
+}
+
+Signalable::Signalable(pid_t pid, int pidfd)
+    : target(pid),
+      d(pidfd != -1 ? new Private{pidfd} : nullptr)
 {
 }
 
+int Signalable::pidfd() const
+{
+    return d ? d->pidfd : -1;
+}
+
 void Signalable::send_signal_or_throw(Signal signal)
 {
-    auto result = ::kill(d->pid, static_cast<int>(signal));
+    auto result = send(target, pidfd(), signal);
 
     if (result == -1)
         throw std::system_error(errno, std::system_category());
@@ -41,7 +91,25 @@ void Signalable::send_signal_or_throw(Signal signal)
 
 void Signalable::send_signal(Signal signal, std::error_code& e) noexcept
 {
-    auto result = ::kill(d->pid, static_cast<int>(signal));
+    auto result = send(target, pidfd(), signal);
+
+    if (result == -1)
+    {
+        e = std::error_code(errno, std::system_category());
+    }
+}
+
+void Signalable::send_signal_with_value_or_throw(Signal signal, int value)
+{
+    auto result = queue(target, pidfd(), signal, value);
+
+    if (result == -1)
+        throw std::system_error(errno, std::system_category());
+}
+
+void Signalable::send_signal_with_value(Signal signal, int value, std::error_code& e) noexcept
+{
+    auto result = queue(target, pidfd(), signal, value);
 
     if (result == -1)
     {
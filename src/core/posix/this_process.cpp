@@ -35,6 +35,8 @@
 extern char** environ;
 #endif
 
+#include <sys/prctl.h>
+
 namespace core
 {
 namespace posix
@@ -158,6 +160,33 @@ Process parent() noexcept(true)
     return Process(getppid());
 }
 
+void set_child_subreaper_or_throw(bool enabled)
+{
+    if (::prctl(PR_SET_CHILD_SUBREAPER, enabled ? 1 : 0, 0, 0, 0) == -1)
+        throw std::system_error(errno, std::system_category());
+}
+
+bool set_child_subreaper(bool enabled, std::error_code& se) noexcept(true)
+{
+    if (::prctl(PR_SET_CHILD_SUBREAPER, enabled ? 1 : 0, 0, 0, 0) == -1)
+    {
+        se = std::error_code(errno, std::system_category());
+        return false;
+    }
+
+    return true;
+}
+
+bool is_child_subreaper_or_throw()
+{
+    int enabled{0};
+
+    if (::prctl(PR_GET_CHILD_SUBREAPER, &enabled, 0, 0, 0) == -1)
+        throw std::system_error(errno, std::system_category());
+
+    return enabled != 0;
+}
+
 std::istream& cin() noexcept(true)
 {
     return std::cin;
@@ -0,0 +1,89 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Thomas Voß <thomas.voss@canonical.com>
+ */
+
+#ifndef CORE_POSIX_WAIT_SUPPORT_H_
+#define CORE_POSIX_WAIT_SUPPORT_H_
+
+#include <core/posix/wait.h>
+
+#include <signal.h>
+
+#include <sys/wait.h>
+
+namespace impl
+{
+// Translates a status as reported by waitpid and friends.
+inline core::posix::wait::Result result_from_status(int status)
+{
+    core::posix::wait::Result result;
+
+    if (WIFEXITED(status))
+    {
+        result.status = core::posix::wait::Result::Status::exited;
+        result.detail.if_exited.status = static_cast<core::posix::exit::Status>(WEXITSTATUS(status));
+    } else if (WIFSIGNALED(status))
+    {
+        result.status = core::posix::wait::Result::Status::signaled;
+        result.detail.if_signaled.signal = static_cast<core::posix::Signal>(WTERMSIG(status));
+        result.detail.if_signaled.core_dumped = WCOREDUMP(status);
+    } else if (WIFSTOPPED(status))
+    {
+        result.status = core::posix::wait::Result::Status::stopped;
+        result.detail.if_stopped.signal = static_cast<core::posix::Signal>(WSTOPSIG(status));
+    } else if (WIFCONTINUED(status))
+    {
+        result.status = core::posix::wait::Result::Status::continued;
+    }
+
+    return result;
+}
+
+// Translates the siginfo as reported by waitid.
+inline core::posix::wait::Result result_from_siginfo(const ::siginfo_t& info)
+{
+    core::posix::wait::Result result;
+
+    switch (info.si_code)
+    {
+    case CLD_EXITED:
+        result.status = core::posix::wait::Result::Status::exited;
+        result.detail.if_exited.status = static_cast<core::posix::exit::Status>(info.si_status);
+        break;
+    case CLD_KILLED:
+    case CLD_DUMPED:
+        result.status = core::posix::wait::Result::Status::signaled;
+        result.detail.if_signaled.signal = static_cast<core::posix::Signal>(info.si_status);
+        result.detail.if_signaled.core_dumped = info.si_code == CLD_DUMPED;
+        break;
+    case CLD_STOPPED:
+    case CLD_TRAPPED:
+        result.status = core::posix::wait::Result::Status::stopped;
+        result.detail.if_stopped.signal = static_cast<core::posix::Signal>(info.si_status);
+        break;
+    case CLD_CONTINUED:
+        result.status = core::posix::wait::Result::Status::continued;
+        break;
+    default:
+        break;
+    }
+
+    return result;
+}
+}
+
+#endif // CORE_POSIX_WAIT_SUPPORT_H_
@@ -0,0 +1,303 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Thomas Voß <thomas.voss@canonical.com>
+ */
+
+#include <core/posix/async_writer.h>
+#include <core/posix/fork.h>
+#include <core/posix/io_engine.h>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+namespace
+{
+// Copies stdin to stdout until end-of-file.
+core::posix::ChildProcess fork_cat()
+{
+    return core::posix::fork([]()
+    {
+        char buffer[4096];
+        ssize_t rc{0};
+        while ((rc = ::read(STDIN_FILENO, buffer, sizeof(buffer))) > 0)
+            if (::write(STDOUT_FILENO, buffer, rc) != rc)
+                return core::posix::exit::Status::failure;
+
+        return rc == 0 ? core::posix::exit::Status::success : core::posix::exit::Status::failure;
+    }, core::posix::StandardStream::stdin | core::posix::StandardStream::stdout);
+}
+
+// Collects everything read from fd into a string, stopping the engine on end-of-file.
+void collect(const std::shared_ptr<core::posix::IoEngine>& engine, int fd, std::string& out)
+{
+    engine->start_reading(fd, [engine, &out](const char* data, std::size_t size, const std::error_code& e)
+    {
+        if (e || size == 0)
+        {
+            engine->stop();
+            return;
+        }
+
+        out.append(data, size);
+    });
+}
+}
+
+TEST(IoEngine, reading_the_output_of_a_child_until_eof_works)
+{
+    auto child = core::posix::fork([]()
+    {
+        std::cout << "hello" << std::flush;
+        std::cout << " world" << std::flush;
+        return core::posix::exit::Status::success;
+    }, core::posix::StandardStream::stdout);
+
+    auto engine = core::posix::create_io_engine();
+
+    std::string out;
+    collect(engine, child.native_handle(core::posix::StandardStream::stdout), out);
+    engine->run();
+
+    EXPECT_EQ("hello world", out);
+    child.wait_for(core::posix::wait::Flags::untraced);
+}
+
+TEST(IoEngine, reading_large_outputs_of_many_children_with_io_uring_works)
+{
+    static const std::size_t child_count = 16;
+    static const std::size_t output_size = 1024 * 1024;
+
+    std::vector<core::posix::ChildProcess> children;
+    for (std::size_t i = 0; i < child_count; i++)
+        children.push_back(core::posix::fork([]()
+        {
+            std::string chunk(4096, 'x');
+            for (std::size_t written = 0; written < output_size; written += chunk.size())
+                std::cout << chunk;
+            std::cout << std::flush;
+            return core::posix::exit::Status::success;
+        }, core::posix::StandardStream::stdout));
+
+    // Falls back to epoll if io_uring is not available, the results have to match either way.
+    auto engine = core::posix::create_io_engine(core::posix::IoEngine::Backend::io_uring);
+
+    std::size_t eofs{0};
+    std::vector<std::size_t> sizes(child_count, 0);
+    for (std::size_t i = 0; i < child_count; i++)
+    {
+        auto& size = sizes[i];
+        engine->start_reading(children[i].native_handle(core::posix::StandardStream::stdout),
+                              [engine, &size, &eofs](const char*, std::size_t n, const std::error_code& e)
+        {
+            if (!e && n > 0)
+            {
+                size += n;
+                return;
+            }
+
+            if (++eofs == child_count)
+                engine->stop();
+        });
+    }
+    engine->run();
+
+    for (auto size : sizes)
+        EXPECT_EQ(output_size, size);
+    EXPECT_EQ(child_count * output_size, engine->statistics().bytes_read);
+
+    for (auto& child : children)
+        child.wait_for(core::posix::wait::Flags::untraced);
+}
+
+TEST(IoEngine, posted_tasks_are_executed_on_the_thread_running_the_engine)
+{
+    auto engine = core::posix::create_io_engine();
+
+    std::thread::id id;
+    engine->post([&id, engine]() { id = std::this_thread::get_id(); engine->stop(); });
+
+    std::thread worker{[engine]() { engine->run(); }};
+    auto worker_id = worker.get_id();
+    worker.join();
+
+    EXPECT_EQ(worker_id, id);
+}
+
+TEST(IoEngine, cancelling_a_wait_invokes_the_handler_with_operation_canceled)
+{
+    for (auto backend : {core::posix::IoEngine::Backend::epoll, core::posix::IoEngine::Backend::io_uring})
+    {
+        int fds[2]; ASSERT_EQ(0, ::pipe(fds));
+        auto engine = core::posix::create_io_engine(backend);
+
+        std::error_code result;
+        engine->async_wait_readable(fds[0], [&result, engine](const std::error_code& e)
+        {
+            result = e;
+            engine->stop();
+        });
+        engine->cancel(fds[0]);
+        engine->run();
+
+        EXPECT_EQ(std::make_error_code(std::errc::operation_canceled), result);
+
+        ::close(fds[0]); ::close(fds[1]);
+    }
+}
+
+TEST(IoEngine, waiting_for_a_pipe_to_become_readable_works)
+{
+    for (auto backend : {core::posix::IoEngine::Backend::epoll, core::posix::IoEngine::Backend::io_uring})
+    {
+        int fds[2]; ASSERT_EQ(0, ::pipe(fds));
+        auto engine = core::posix::create_io_engine(backend);
+
+        std::error_code result = std::make_error_code(std::errc::operation_canceled);
+        engine->async_wait_readable(fds[0], [&result, engine](const std::error_code& e)
+        {
+            result = e;
+            engine->stop();
+        });
+        ASSERT_EQ(1, ::write(fds[1], "x", 1));
+        engine->run();
+
+        EXPECT_FALSE(result);
+
+        ::close(fds[0]); ::close(fds[1]);
+    }
+}
+
+TEST(AsyncWriter, writing_many_small_buffers_and_closing_stdin_works)
+{
+    auto child = fork_cat();
+    auto engine = core::posix::create_io_engine();
+    auto writer = core::posix::AsyncWriter::create_for_stdin(engine, child);
+
+    std::string expected;
+    for (int i = 0; i < 10000; i++)
+    {
+        auto line = std::to_string(i) + "\n";
+        expected += line;
+        writer->write(line);
+    }
+    writer->close_stdin();
+
+    auto flushed = writer->flushed();
+
+    std::string out;
+    collect(engine, child.native_handle(core::posix::StandardStream::stdout), out);
+    engine->run();
+
+    EXPECT_EQ(std::future_status::ready, flushed.wait_for(std::chrono::seconds{0}));
+    EXPECT_NO_THROW(flushed.get());
+    EXPECT_EQ(0u, writer->pending());
+    EXPECT_EQ(expected, out);
+
+    auto result = child.wait_for(core::posix::wait::Flags::untraced);
+    EXPECT_EQ(core::posix::wait::Result::Status::exited, result.status);
+    EXPECT_EQ(core::posix::exit::Status::success, result.detail.if_exited.status);
+}
+
+TEST(AsyncWriter, writing_through_an_io_uring_engine_works)
+{
+    auto child = fork_cat();
+    auto engine = core::posix::create_io_engine(core::posix::IoEngine::Backend::io_uring);
+    auto writer = core::posix::AsyncWriter::create_for_stdin(engine, child);
+
+    std::string expected;
+    for (int i = 0; i < 100000; i++)
+    {
+        auto line = std::to_string(i) + "\n";
+        expected += line;
+        writer->write(line);
+    }
+    writer->close_stdin();
+
+    std::string out;
+    collect(engine, child.native_handle(core::posix::StandardStream::stdout), out);
+    engine->run();
+
+    EXPECT_EQ(expected, out);
+    EXPECT_EQ(expected.size(), engine->statistics().bytes_written);
+
+    auto result = child.wait_for(core::posix::wait::Flags::untraced);
+    EXPECT_EQ(core::posix::wait::Result::Status::exited, result.status);
+}
+
+TEST(AsyncWriter, backpressure_is_reported_and_released)
+{
+    auto child = fork_cat();
+    auto engine = core::posix::create_io_engine();
+
+    core::posix::AsyncWriter::Configuration configuration;
+    configuration.high_watermark = 4 * 1024 * 1024;
+    configuration.low_watermark = 1024;
+
+    auto writer = core::posix::AsyncWriter::create_for_stdin(engine, child, configuration);
+
+    std::vector<bool> changes;
+    core::ScopedConnection sc
+    {
+        writer->backpressure_changed().connect([&changes](bool backpressured)
+        {
+            changes.push_back(backpressured);
+        })
+    };
+
+    // The engine is not running yet, so everything stays queued.
+    EXPECT_TRUE(writer->write(std::string(configuration.high_watermark / 2, 'a')));
+    EXPECT_FALSE(writer->write(std::string(configuration.high_watermark / 2, 'b')));
+    EXPECT_TRUE(writer->is_backpressured());
+
+    writer->close_stdin();
+    EXPECT_THROW(writer->write(std::string(1, 'c')), std::logic_error);
+
+    std::string out;
+    collect(engine, child.native_handle(core::posix::StandardStream::stdout), out);
+    engine->run();
+
+    EXPECT_FALSE(writer->is_backpressured());
+    ASSERT_EQ(2u, changes.size());
+    EXPECT_TRUE(changes[0]);
+    EXPECT_FALSE(changes[1]);
+    EXPECT_EQ(configuration.high_watermark, out.size());
+
+    child.wait_for(core::posix::wait::Flags::untraced);
+}
+
+TEST(AsyncWriter, writing_to_a_child_that_went_away_reports_an_error)
+{
+    auto child = core::posix::fork([]() { return core::posix::exit::Status::success; },
+                                   core::posix::StandardStream::stdin);
+    child.wait_for(core::posix::wait::Flags::untraced);
+
+    auto engine = core::posix::create_io_engine();
+    auto writer = core::posix::AsyncWriter::create_for_stdin(engine, child);
+
+    writer->write("lost");
+    auto flushed = writer->flushed();
+
+    std::thread worker{[engine]() { engine->run(); }};
+
+    EXPECT_THROW(flushed.get(), std::system_error);
+    engine->stop();
+    worker.join();
+}
@@ -0,0 +1,172 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Thomas Voß <thomas.voss@canonical.com>
+ */
+
+#include <core/posix/exec.h>
+#include <core/posix/fork.h>
+#include <core/posix/linux/cgroup.h>
+#include <core/posix/this_process.h>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <time.h>
+#include <unistd.h>
+
+namespace
+{
+// Polls predicate for up to a couple of seconds, as the kernel applies
+// some state changes of cgroups asynchronously.
+bool eventually(const std::function<bool()>& predicate)
+{
+    for (int i = 0; i < 500; i++)
+    {
+        if (predicate())
+            return true;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+
+    return false;
+}
+
+// Runs tests in a fresh cgroup below the one we belong to, and skips
+// them if we cannot create one, e.g., without a delegated subtree.
+struct Cgroup : public ::testing::Test
+{
+    void SetUp() override
+    {
+        try
+        {
+            auto parent = core::posix::linux::Cgroup::of_this_process_or_throw();
+            job = std::make_shared<core::posix::linux::Cgroup>(
+                        parent.create_child_or_throw("process-cpp-test-" + std::to_string(::getpid())));
+        } catch(const std::system_error& e)
+        {
+            GTEST_SKIP() << "No cgroup v2 subtree available: " << e.what();
+        }
+    }
+
+    void TearDown() override
+    {
+        if (!job)
+            return;
+
+        std::error_code ignored;
+        job->kill(ignored);
+        eventually([this]() { return !job->is_populated_or_throw(); });
+        job->remove(ignored);
+    }
+
+    std::shared_ptr<core::posix::linux::Cgroup> job;
+};
+}
+
+TEST_F(Cgroup, a_job_spawned_into_a_cgroup_is_frozen_thawed_and_killed_as_a_unit)
+{
+    // The shell forks two grandchildren, which end up in the cgroup, too.
+    auto child = core::posix::exec("/bin/sh",
+                                   {"-c", "sleep 100 & sleep 100 & wait"},
+                                   std::map<std::string, std::string>{},
+                                   core::posix::StandardStream::empty,
+                                   job->enter_in_child());
+
+    EXPECT_TRUE(eventually([this]() { return job->processes_or_throw().size() == 3; }));
+    EXPECT_TRUE(job->is_populated_or_throw());
+
+    job->freeze_or_throw();
+    EXPECT_TRUE(eventually([this]() { return job->is_frozen_or_throw(); }));
+
+    job->thaw_or_throw();
+    EXPECT_TRUE(eventually([this]() { return !job->is_frozen_or_throw(); }));
+
+    job->kill_or_throw();
+
+    auto result = child.wait_for(core::posix::wait::Flags::untraced);
+    EXPECT_EQ(core::posix::wait::Result::Status::signaled, result.status);
+    EXPECT_EQ(core::posix::Signal::sig_kill, result.detail.if_signaled.signal);
+
+    EXPECT_TRUE(eventually([this]() { return !job->is_populated_or_throw(); }));
+}
+
+TEST_F(Cgroup, cpu_time_of_all_processes_in_a_cgroup_is_accounted_for)
+{
+    static const std::chrono::milliseconds busy{200};
+
+    auto enter = job->enter_in_child();
+    auto child = core::posix::fork([enter]()
+    {
+        enter();
+
+        // Spinning on wall time would undercount on a loaded machine, so we
+        // spin until we have actually been on a cpu for long enough.
+        auto cpu_time = []()
+        {
+            ::timespec ts;
+            ::clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+            return std::chrono::seconds{ts.tv_sec} + std::chrono::nanoseconds{ts.tv_nsec};
+        };
+
+        auto start = cpu_time();
+        while (cpu_time() - start < busy);
+
+        return core::posix::exit::Status::success;
+    }, core::posix::StandardStream::empty);
+
+    auto result = child.wait_for(core::posix::wait::Flags::untraced);
+    EXPECT_EQ(core::posix::wait::Result::Status::exited, result.status);
+    EXPECT_EQ(core::posix::exit::Status::success, result.detail.if_exited.status);
+
+    auto stat = job->cpu_stat_or_throw();
+    EXPECT_LE(busy, stat.usage);
+    EXPECT_LE(stat.user + stat.system, stat.usage + std::chrono::milliseconds{10});
+
+    // The memory controller might not be enabled for our subtree.
+    try
+    {
+        job->memory_current_or_throw();
+    } catch(const std::system_error& e)
+    {
+        EXPECT_EQ(std::errc::no_such_file_or_directory, e.code());
+    }
+}
+
+TEST_F(Cgroup, adding_an_existing_process_moves_it)
+{
+    auto child = core::posix::fork([]()
+    {
+        while (true)
+            std::this_thread::sleep_for(std::chrono::seconds{1});
+
+        return core::posix::exit::Status::failure;
+    }, core::posix::StandardStream::empty);
+
+    EXPECT_TRUE(job->processes_or_throw().empty());
+
+    job->add_or_throw(child);
+    EXPECT_EQ(std::vector<pid_t>{child.pid()}, job->processes_or_throw());
+
+    job->kill_or_throw();
+    auto result = child.wait_for(core::posix::wait::Flags::untraced);
+    EXPECT_EQ(core::posix::wait::Result::Status::signaled, result.status);
+}
@@ -0,0 +1,148 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Thomas Voß <thomas.voss@canonical.com>
+ */
+
+#include <core/posix/coroutines.h>
+#include <core/posix/fork.h>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace coro = core::posix::coroutines;
+
+namespace
+{
+// Copies stdin to stdout until end-of-file.
+core::posix::ChildProcess fork_cat()
+{
+    return core::posix::fork([]()
+    {
+        char buffer[4096];
+        ssize_t rc{0};
+        while ((rc = ::read(STDIN_FILENO, buffer, sizeof(buffer))) > 0)
+            if (::write(STDOUT_FILENO, buffer, rc) != rc)
+                return core::posix::exit::Status::failure;
+
+        return rc == 0 ? core::posix::exit::Status::success : core::posix::exit::Status::failure;
+    }, core::posix::StandardStream::stdin | core::posix::StandardStream::stdout);
+}
+
+coro::Task<std::string> read_all(coro::Child& child)
+{
+    std::string result;
+    std::array<char, 4096> buffer;
+
+    while (auto size = co_await child.read_some(buffer))
+        result.append(buffer.data(), size);
+
+    co_return result;
+}
+
+coro::Task<> await_exit(coro::Child& child, core::posix::wait::Result& result)
+{
+    result = co_await child.exited();
+}
+
+coro::Task<> feed(coro::Child& child, const std::string& payload)
+{
+    co_await child.write(payload);
+    child.process().close_stdin();
+}
+
+coro::Task<> drain(coro::Child& child, std::string& output, core::posix::wait::Result& result)
+{
+    output = co_await read_all(child);
+    result = co_await child.exited();
+}
+
+coro::Task<> read_from_stdout(coro::Child& child)
+{
+    char buffer[16];
+    co_await child.read_some(buffer);
+}
+}
+
+TEST(Coroutines, awaiting_the_exit_of_a_child_yields_its_exit_status)
+{
+    coro::Executor executor;
+    coro::Child child
+    {
+        executor,
+        core::posix::fork([]() { return core::posix::exit::Status::failure; }, core::posix::StandardStream::empty)
+    };
+
+    core::posix::wait::Result result;
+    executor.spawn(await_exit(child, result));
+    executor.run();
+
+    EXPECT_EQ(core::posix::wait::Result::Status::exited, result.status);
+    EXPECT_EQ(core::posix::exit::Status::failure, result.detail.if_exited.status);
+}
+
+TEST(Coroutines, many_children_are_served_concurrently_from_a_single_thread)
+{
+    static const std::size_t child_count = 32;
+    static const std::string payload(256 * 1024, 'x');
+
+    coro::Executor executor;
+    std::vector<std::unique_ptr<coro::Child>> children;
+    std::vector<std::string> outputs(child_count);
+    std::vector<core::posix::wait::Result> results(child_count);
+
+    for (std::size_t i = 0; i < child_count; i++)
+    {
+        children.emplace_back(new coro::Child{executor, fork_cat()});
+        auto& child = *children.back();
+
+        // The payload exceeds the pipe capacity, so writing and reading
+        // have to interleave for the child to make progress.
+        executor.spawn(feed(child, payload));
+        executor.spawn(drain(child, outputs[i], results[i]));
+    }
+
+    executor.run();
+
+    for (std::size_t i = 0; i < child_count; i++)
+    {
+        EXPECT_EQ(payload, outputs[i]);
+        EXPECT_EQ(core::posix::wait::Result::Status::exited, results[i].status);
+        EXPECT_EQ(core::posix::exit::Status::success, results[i].detail.if_exited.status);
+    }
+}
+
+TEST(Coroutines, exceptions_escaping_a_task_are_rethrown_from_run)
+{
+    coro::Executor executor;
+    coro::Child child
+    {
+        executor,
+        core::posix::fork([]() { return core::posix::exit::Status::success; }, core::posix::StandardStream::empty)
+    };
+
+    core::posix::wait::Result result;
+
+    // stdout has not been redirected.
+    executor.spawn(read_from_stdout(child));
+    executor.spawn(await_exit(child, result));
+
+    EXPECT_THROW(executor.run(), std::logic_error);
+}
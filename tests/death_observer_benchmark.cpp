@@ -0,0 +1,131 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Thomas Voß <thomas.voss@canonical.com>
+ */
+
+#include <core/posix/child_process.h>
+#include <core/posix/fork.h>
+#include <core/posix/signal.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Measures how long DeathObserver::add() takes while several threads add
+// short-lived children concurrently, and a worker thread reaps them and
+// notifies a deliberately slow subscriber.
+namespace
+{
+const std::size_t thread_count = 8;
+const std::size_t children_per_thread = 64;
+const std::chrono::microseconds subscriber_delay{500};
+
+struct Init
+{
+    Init()
+        : signal_trap(
+              core::posix::trap_signals_for_all_subsequent_threads(
+                  {core::posix::Signal::sig_chld}))
+    {
+    }
+
+    std::shared_ptr<core::posix::SignalTrap> signal_trap;
+} init;
+
+struct Latencies
+{
+    std::chrono::duration<double> total{0};
+    std::chrono::duration<double> max{0};
+    std::size_t count{0};
+};
+}
+
+TEST(DeathObserverBenchmark, adding_children_from_many_threads_with_a_slow_subscriber)
+{
+    auto observer = core::posix::ChildProcess::DeathObserver::create_with_signal_trap(init.signal_trap);
+
+    std::atomic<std::size_t> deaths{0};
+    core::ScopedConnection sc
+    {
+        observer->child_died().connect([&deaths](const core::posix::ChildProcess&)
+        {
+            std::this_thread::sleep_for(subscriber_delay);
+            deaths++;
+        })
+    };
+
+    std::thread reaper{[]() { init.signal_trap->run(); }};
+
+    std::vector<Latencies> latencies(thread_count);
+    std::vector<std::thread> adders;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (std::size_t i = 0; i < thread_count; i++)
+        adders.emplace_back([&observer, &latencies, i]()
+        {
+            for (std::size_t j = 0; j < children_per_thread; j++)
+            {
+                auto child = core::posix::fork([]()
+                {
+                    return core::posix::exit::Status::success;
+                }, core::posix::StandardStream::empty);
+
+                auto before = std::chrono::steady_clock::now();
+                observer->add(child);
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - before;
+
+                latencies[i].total += elapsed;
+                latencies[i].max = std::max(latencies[i].max, elapsed);
+                latencies[i].count++;
+            }
+        });
+
+    for (auto& adder : adders)
+        adder.join();
+
+    static const std::size_t expected = thread_count * children_per_thread;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{30};
+    while (deaths.load() < expected && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+
+    std::chrono::duration<double> wall = std::chrono::steady_clock::now() - start;
+
+    init.signal_trap->stop();
+    reaper.join();
+
+    Latencies overall;
+    for (const auto& l : latencies)
+    {
+        overall.total += l.total;
+        overall.max = std::max(overall.max, l.max);
+        overall.count += l.count;
+    }
+
+    std::cout << std::fixed << std::setprecision(2)
+              << thread_count << " threads, " << expected << " children: "
+              << 1e6 * overall.total.count() / overall.count << " us mean add(), "
+              << 1e6 * overall.max.count() << " us max add(), "
+              << 1000. * wall.count() << " ms total" << std::endl;
+
+    EXPECT_EQ(expected, deaths.load());
+}
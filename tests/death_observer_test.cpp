@@ -17,12 +17,22 @@
  */
 
 #include <core/posix/child_process.h>
+#include <core/posix/fork.h>
 #include <core/posix/signal.h>
+#include <core/posix/this_process.h>
 
 #include <core/testing/fork_and_run.h>
 
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include <unistd.h>
+
+#include <sys/wait.h>
+
 TESTP(DeathObserver, construction_and_deconstruction_works,
 {
   auto trap = core::posix::trap_signals_for_all_subsequent_threads({core::posix::Signal::sig_chld});
@@ -34,3 +44,131 @@ TESTP(DeathObserver, construction_with_a_trap_not_including_sig_chld_throws,
     auto trap = core::posix::trap_signals_for_all_subsequent_threads({core::posix::Signal::sig_term});
     EXPECT_ANY_THROW(auto death_observer = core::posix::ChildProcess::DeathObserver::create_once_with_signal_trap(trap));
 })
+
+namespace
+{
+// Forks a grandchild that sleeps for the given duration, reports its pid and exits right away.
+core::posix::ChildProcess fork_worker_leaving_an_orphan(const std::chrono::milliseconds& lifetime)
+{
+    return core::posix::fork([lifetime]()
+    {
+        pid_t pid = ::fork();
+
+        if (pid == 0)
+        {
+            std::this_thread::sleep_for(lifetime);
+            ::_exit(static_cast<int>(core::posix::exit::Status::success));
+        }
+
+        std::cout << pid << std::endl;
+        return core::posix::exit::Status::success;
+    }, core::posix::StandardStream::stdout);
+}
+}
+
+TESTP(DeathObserver, orphans_are_reaped_and_reported_if_requested,
+{
+    auto trap = core::posix::trap_signals_for_all_subsequent_threads({core::posix::Signal::sig_chld});
+    auto death_observer = core::posix::ChildProcess::DeathObserver::create_once_with_signal_trap(trap);
+
+    death_observer->set_orphan_policy(core::posix::ChildProcess::DeathObserver::OrphanPolicy::reap);
+    EXPECT_TRUE(core::posix::this_process::is_child_subreaper_or_throw());
+
+    core::posix::ChildProcess::DeathObserver::Exit orphan;
+    orphan.pid = -1;
+
+    core::ScopedConnection sc
+    {
+        death_observer->orphan_died().connect([&orphan, trap](const core::posix::ChildProcess::DeathObserver::Exit& exit)
+        {
+            orphan = exit;
+            trap->stop();
+        })
+    };
+
+    std::thread worker{[trap]() { trap->run(); }};
+
+    auto child = fork_worker_leaving_an_orphan(std::chrono::milliseconds{100});
+    death_observer->add(child);
+
+    pid_t grandchild{-1}; child.cout() >> grandchild;
+
+    if (worker.joinable())
+        worker.join();
+
+    EXPECT_EQ(grandchild, orphan.pid);
+    EXPECT_EQ(core::posix::wait::Result::Status::exited, orphan.result.status);
+})
+
+TESTP(DeathObserver, orphans_are_killed_right_away_if_requested,
+{
+    auto trap = core::posix::trap_signals_for_all_subsequent_threads({core::posix::Signal::sig_chld});
+    auto death_observer = core::posix::ChildProcess::DeathObserver::create_once_with_signal_trap(trap);
+
+    death_observer->set_orphan_policy(core::posix::ChildProcess::DeathObserver::OrphanPolicy::kill_and_reap);
+
+    core::posix::ChildProcess::DeathObserver::Exit orphan;
+    orphan.pid = -1;
+
+    core::ScopedConnection sc
+    {
+        death_observer->orphan_died().connect([&orphan, trap](const core::posix::ChildProcess::DeathObserver::Exit& exit)
+        {
+            orphan = exit;
+            trap->stop();
+        })
+    };
+
+    std::thread worker{[trap]() { trap->run(); }};
+
+    auto child = fork_worker_leaving_an_orphan(std::chrono::hours{1});
+    death_observer->add(child);
+
+    pid_t grandchild{-1}; child.cout() >> grandchild;
+
+    if (worker.joinable())
+        worker.join();
+
+    EXPECT_EQ(grandchild, orphan.pid);
+    EXPECT_EQ(core::posix::wait::Result::Status::signaled, orphan.result.status);
+    EXPECT_EQ(core::posix::Signal::sig_kill, orphan.result.detail.if_signaled.signal);
+})
+
+TESTP(DeathObserver, children_let_go_of_are_not_mistaken_for_orphans,
+{
+    auto trap = core::posix::trap_signals_for_all_subsequent_threads({core::posix::Signal::sig_chld});
+    auto death_observer = core::posix::ChildProcess::DeathObserver::create_once_with_signal_trap(trap);
+
+    death_observer->set_orphan_policy(core::posix::ChildProcess::DeathObserver::OrphanPolicy::kill_and_reap);
+
+    pid_t kept{-1};
+    {
+        auto child = core::posix::fork([]() { while (true) ::pause(); return core::posix::exit::Status::failure; },
+                                       core::posix::StandardStream::empty);
+        child.set_destruction_policy(core::posix::ChildProcess::DestructionPolicy::keep_running);
+        kept = child.pid();
+    }
+
+    core::ScopedConnection sc
+    {
+        death_observer->child_died().connect([&](const core::posix::ChildProcess&) { trap->stop(); })
+    };
+
+    std::thread worker{[&]() { trap->run(); }};
+
+    // Orphans are checked on once the observed child has died.
+    auto child = core::posix::fork([]() { return core::posix::exit::Status::success; },
+                                   core::posix::StandardStream::empty);
+    death_observer->add(child);
+
+    if (worker.joinable())
+        worker.join();
+
+    int status{-1};
+    EXPECT_EQ(0, ::waitpid(kept, &status, WNOHANG));
+
+    EXPECT_EQ(0, ::kill(kept, SIGTERM));
+    EXPECT_EQ(kept, ::waitpid(kept, &status, 0));
+    EXPECT_TRUE(WIFSIGNALED(status));
+    EXPECT_EQ(SIGTERM, WTERMSIG(status));
+})
@@ -0,0 +1,132 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Thomas Voß <thomas.voss@canonical.com>
+ */
+
+#include <core/posix/child_process.h>
+#include <core/posix/fork.h>
+#include <core/posix/process.h>
+#include <core/posix/process_group.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+// Measures the cost of constructing and copying process handles, together
+// with the number of heap allocations per operation. Allocations are
+// counted by replacing the global allocation functions.
+namespace
+{
+std::atomic<std::size_t> allocations{0};
+
+const std::size_t iterations = 1000 * 1000;
+
+struct Sample
+{
+    std::chrono::duration<double> wall;
+    std::size_t allocations;
+};
+
+template<typename Operation>
+Sample measure(Operation operation)
+{
+    volatile pid_t sink{0};
+
+    auto before = allocations.load();
+    auto start = std::chrono::steady_clock::now();
+
+    for (std::size_t i = 0; i < iterations; i++)
+        sink = sink + operation();
+
+    return Sample{std::chrono::steady_clock::now() - start, allocations.load() - before};
+}
+
+void report(const std::string& name, const Sample& sample)
+{
+    std::cout << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(2)
+              << std::setw(10) << 1e9 * sample.wall.count() / iterations << " ns/op"
+              << std::setw(10) << static_cast<double>(sample.allocations) / iterations << " allocations/op"
+              << std::endl;
+}
+}
+
+void* operator new(std::size_t size)
+{
+    allocations++;
+
+    if (auto p = std::malloc(size == 0 ? 1 : size))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+TEST(HandleBenchmark, constructing_and_copying_process_handles)
+{
+    auto child = core::posix::fork([]()
+    {
+        while (true)
+            std::this_thread::sleep_for(std::chrono::seconds{1});
+
+        return core::posix::exit::Status::failure;
+    }, core::posix::StandardStream::empty);
+
+    const core::posix::Process process{child.pid()};
+    const auto opened = core::posix::Process::open_or_throw(child.pid());
+    const auto group = core::posix::ProcessGroup::led_by(process);
+
+    auto construct_process = measure([&child]() { return core::posix::Process{child.pid()}.pid(); });
+    auto copy_process = measure([&process]() { auto copy = process; return copy.pid(); });
+    auto copy_opened = measure([&opened]() { auto copy = opened; return copy.pid(); });
+    auto construct_group = measure([&process]() { return core::posix::ProcessGroup::led_by(process).id(); });
+    auto copy_group = measure([&group]() { auto copy = group; return copy.id(); });
+    auto copy_child = measure([&child]() { auto copy = child; return copy.pid(); });
+
+    report("construct Process", construct_process);
+    report("copy Process", copy_process);
+    report("copy opened Process", copy_opened);
+    report("construct ProcessGroup", construct_group);
+    report("copy ProcessGroup", copy_group);
+    report("copy ChildProcess", copy_child);
+
+    EXPECT_EQ(0u, construct_process.allocations);
+    EXPECT_EQ(0u, copy_process.allocations);
+    EXPECT_EQ(0u, copy_opened.allocations);
+    EXPECT_EQ(0u, construct_group.allocations);
+    EXPECT_EQ(0u, copy_group.allocations);
+    EXPECT_EQ(0u, copy_child.allocations);
+
+    child.send_signal_or_throw(core::posix::Signal::sig_kill);
+    child.wait_for(core::posix::wait::Flags::untraced);
+}
@@ -0,0 +1,187 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Thomas Voß <thomas.voss@canonical.com>
+ */
+
+#include <core/posix/fork.h>
+#include <core/posix/io_engine.h>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+// Compares draining the stdout of many children via the blocking
+// ChildProcess::cout() streams with draining them via the IoEngine
+// backends. For every variant, we report the number of system calls per
+// second and per MiB, together with the CPU time spent per MiB.
+namespace
+{
+const std::size_t child_count = 64;
+const std::size_t output_size = 4 * 1024 * 1024;
+const double mib = 1024. * 1024.;
+
+struct Sample
+{
+    std::uint64_t system_calls;
+    std::uint64_t bytes;
+    std::chrono::duration<double> wall;
+    std::chrono::duration<double> cpu;
+};
+
+std::chrono::duration<double> cpu_time()
+{
+    ::rusage usage; ::getrusage(RUSAGE_SELF, &usage);
+
+    return std::chrono::seconds{usage.ru_utime.tv_sec + usage.ru_stime.tv_sec} +
+           std::chrono::microseconds{usage.ru_utime.tv_usec + usage.ru_stime.tv_usec};
+}
+
+// The blocking streams do not keep statistics, so we resort to the number
+// of read system calls the kernel accounts for this process.
+std::uint64_t read_system_calls()
+{
+    std::ifstream in("/proc/self/io");
+    std::string key; std::uint64_t value{0};
+
+    while (in >> key >> value)
+        if (key == "syscr:")
+            return value;
+
+    return 0;
+}
+
+std::vector<core::posix::ChildProcess> fork_writers()
+{
+    std::vector<core::posix::ChildProcess> children;
+
+    for (std::size_t i = 0; i < child_count; i++)
+        children.push_back(core::posix::fork([]()
+        {
+            static const std::string chunk(64 * 1024, 'x');
+            for (std::size_t written = 0; written < output_size; written += chunk.size())
+                if (::write(STDOUT_FILENO, chunk.data(), chunk.size()) != static_cast<ssize_t>(chunk.size()))
+                    return core::posix::exit::Status::failure;
+
+            return core::posix::exit::Status::success;
+        }, core::posix::StandardStream::stdout));
+
+    return children;
+}
+
+void reap(std::vector<core::posix::ChildProcess>& children)
+{
+    for (auto& child : children)
+        child.wait_for(core::posix::wait::Flags::untraced);
+}
+
+Sample drain_with_streams()
+{
+    auto children = fork_writers();
+
+    auto syscr = read_system_calls();
+    auto cpu = cpu_time();
+    auto start = std::chrono::steady_clock::now();
+
+    std::uint64_t bytes{0};
+    std::vector<char> buffer(64 * 1024);
+    for (auto& child : children)
+    {
+        auto& in = child.cout();
+        while (in.read(buffer.data(), buffer.size()) || in.gcount() > 0)
+            bytes += in.gcount();
+    }
+
+    Sample sample
+    {
+        read_system_calls() - syscr,
+        bytes,
+        std::chrono::steady_clock::now() - start,
+        cpu_time() - cpu
+    };
+
+    reap(children);
+    return sample;
+}
+
+Sample drain_with_engine(core::posix::IoEngine::Backend backend)
+{
+    auto children = fork_writers();
+    auto engine = core::posix::create_io_engine(backend);
+
+    auto cpu = cpu_time();
+    auto start = std::chrono::steady_clock::now();
+
+    std::size_t eofs{0};
+    for (auto& child : children)
+        engine->start_reading(child.native_handle(core::posix::StandardStream::stdout),
+                              [engine, &eofs](const char*, std::size_t size, const std::error_code& e)
+        {
+            if ((e || size == 0) && ++eofs == child_count)
+                engine->stop();
+        });
+    engine->run();
+
+    auto statistics = engine->statistics();
+    Sample sample
+    {
+        statistics.system_calls,
+        statistics.bytes_read,
+        std::chrono::steady_clock::now() - start,
+        cpu_time() - cpu
+    };
+
+    reap(children);
+    return sample;
+}
+
+void report(const std::string& name, const Sample& sample)
+{
+    auto mibs = sample.bytes / mib;
+
+    std::cout << std::left << std::setw(12) << name << std::right << std::fixed << std::setprecision(2)
+              << std::setw(14) << sample.system_calls / sample.wall.count() << " syscalls/s"
+              << std::setw(12) << sample.system_calls / mibs << " syscalls/MiB"
+              << std::setw(12) << 1000. * sample.cpu.count() / mibs << " ms CPU/MiB"
+              << std::setw(12) << mibs / sample.wall.count() << " MiB/s" << std::endl;
+}
+}
+
+TEST(IoEngineBenchmark, draining_many_children_with_blocking_streams_and_engines)
+{
+    auto streams = drain_with_streams();
+    auto epoll = drain_with_engine(core::posix::IoEngine::Backend::epoll);
+    auto io_uring = drain_with_engine(core::posix::IoEngine::Backend::io_uring);
+
+    report("streams", streams);
+    report("epoll", epoll);
+    if (core::posix::create_io_engine(core::posix::IoEngine::Backend::io_uring)->backend() ==
+            core::posix::IoEngine::Backend::io_uring)
+        report("io_uring", io_uring);
+    else
+        std::cout << "io_uring is not available, skipping." << std::endl;
+
+    EXPECT_EQ(child_count * output_size, streams.bytes);
+    EXPECT_EQ(child_count * output_size, epoll.bytes);
+    EXPECT_EQ(child_count * output_size, io_uring.bytes);
+}
@@ -23,10 +23,25 @@
 #include <core/posix/linux/proc/process/oom_adj.h>
 #include <core/posix/linux/proc/process/oom_score.h>
 #include <core/posix/linux/proc/process/oom_score_adj.h>
+#include <core/posix/linux/proc/process_tree.h>
+#include <core/posix/linux/zero_copy.h>
 
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <chrono>
 #include <map>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+#include <cstdio>
+
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 
 TEST(LinuxProcess, accessing_proc_stats_works)
 {
@@ -156,3 +171,285 @@ TEST(LinuxProcess, trying_to_write_an_invalid_oom_adj_throws)
 
     EXPECT_ANY_THROW(core::posix::this_process::instance() << invalid_adj);
 }
+
+namespace
+{
+// Forks a child that forks a grandchild escaping into a new session. Both
+// of them keep on running until signalled.
+core::posix::ChildProcess fork_child_with_detached_grandchild()
+{
+    return core::posix::fork([]()
+    {
+        if (::fork() == 0)
+        {
+            ::setsid();
+            while (true)
+                ::pause();
+        }
+
+        while (true)
+            ::pause();
+
+        return core::posix::exit::Status::failure;
+    }, core::posix::StandardStream::empty);
+}
+
+// Waits for the grandchild of child to show up in the process tree.
+pid_t grandchild_of(const core::posix::ChildProcess& child)
+{
+    for (int i = 0; i < 500; i++)
+    {
+        auto tree = core::posix::linux::proc::ProcessTree::snapshot_or_throw();
+        if (tree.children_of(child.pid()).size() == 1)
+            return tree.children_of(child.pid()).front();
+
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+
+    return -1;
+}
+
+// A killed grandchild is reparented and might linger as a zombie for a bit.
+bool is_gone(pid_t pid)
+{
+    for (int i = 0; i < 500; i++)
+    {
+        core::posix::linux::proc::process::Stat stat;
+        core::posix::Process{pid} >> stat;
+
+        if (stat.state == core::posix::linux::proc::process::State::undefined ||
+            stat.state == core::posix::linux::proc::process::State::zombie)
+            return true;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+
+    return false;
+}
+}
+
+TEST(LinuxProcessTree, a_snapshot_indexes_parents_and_children)
+{
+    auto child = fork_child_with_detached_grandchild();
+    auto grandchild = grandchild_of(child);
+    ASSERT_NE(-1, grandchild);
+
+    auto tree = core::posix::linux::proc::ProcessTree::snapshot_or_throw();
+
+    EXPECT_TRUE(tree.contains(::getpid()));
+    EXPECT_EQ(::getppid(), tree.parent_of(::getpid()));
+    EXPECT_EQ(::getpid(), tree.parent_of(child.pid()));
+    EXPECT_EQ(child.pid(), tree.parent_of(grandchild));
+
+    auto subtree = tree.subtree_of(child.pid());
+    EXPECT_EQ((std::vector<pid_t>{child.pid(), grandchild}), subtree);
+
+    core::posix::linux::proc::kill_tree_or_throw(child.pid(), core::posix::Signal::sig_kill);
+}
+
+TEST(LinuxProcessTree, snapshots_taken_while_processes_exit_succeed)
+{
+    static const int churn_thread_count = 4;
+    static const int snapshot_count = 1000;
+
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> churn;
+
+    // Exiting processes vanish from /proc while a snapshot walks it.
+    for (int i = 0; i < churn_thread_count; i++)
+        churn.emplace_back([&stop]()
+        {
+            while (!stop.load())
+            {
+                pid_t pid = ::fork();
+                if (pid == 0)
+                    ::_exit(0);
+
+                if (pid > 0)
+                    ::waitpid(pid, nullptr, 0);
+            }
+        });
+
+    int failures{0};
+    for (int i = 0; i < snapshot_count; i++)
+    {
+        try
+        {
+            core::posix::linux::proc::ProcessTree::snapshot_or_throw();
+        } catch(const std::system_error&)
+        {
+            failures++;
+        }
+    }
+
+    stop.store(true);
+    for (auto& thread : churn)
+        thread.join();
+
+    EXPECT_EQ(0, failures);
+}
+
+TEST(LinuxProcessTree, killing_a_tree_reaches_descendants_in_other_sessions)
+{
+    auto child = fork_child_with_detached_grandchild();
+    auto grandchild = grandchild_of(child);
+    ASSERT_NE(-1, grandchild);
+
+    // The grandchild is not part of the child's process group.
+    EXPECT_NE(child.process_group_or_throw().id(), core::posix::Process{grandchild}.process_group_or_throw().id());
+
+    core::posix::linux::proc::kill_tree_or_throw(child.pid(), core::posix::Signal::sig_kill);
+
+    auto result = child.wait_for(core::posix::wait::Flags::untraced);
+    EXPECT_EQ(core::posix::wait::Result::Status::signaled, result.status);
+    EXPECT_EQ(core::posix::Signal::sig_kill, result.detail.if_signaled.signal);
+    EXPECT_TRUE(is_gone(grandchild));
+}
+
+TEST(LinuxProcessTree, killing_a_tree_with_a_catchable_signal_continues_the_tree)
+{
+    auto child = fork_child_with_detached_grandchild();
+    auto grandchild = grandchild_of(child);
+    ASSERT_NE(-1, grandchild);
+
+    core::posix::linux::proc::kill_tree_or_throw(child.pid(), core::posix::Signal::sig_term);
+
+    auto result = child.wait_for(core::posix::wait::Flags::untraced);
+    EXPECT_EQ(core::posix::wait::Result::Status::signaled, result.status);
+    EXPECT_EQ(core::posix::Signal::sig_term, result.detail.if_signaled.signal);
+    EXPECT_TRUE(is_gone(grandchild));
+}
+
+TEST(LinuxProcessTree, killing_the_tree_of_a_non_existing_process_reports_error)
+{
+    auto child = core::posix::fork([]() { return core::posix::exit::Status::success; },
+                                   core::posix::StandardStream::empty);
+    child.wait_for(core::posix::wait::Flags::untraced);
+
+    std::error_code e;
+    core::posix::linux::proc::kill_tree(child.pid(), core::posix::Signal::sig_kill, e);
+    EXPECT_EQ(std::errc::no_such_process, e);
+    EXPECT_THROW(core::posix::linux::proc::kill_tree_or_throw(child.pid(), core::posix::Signal::sig_kill),
+                 std::system_error);
+}
+
+namespace
+{
+// Reads exactly size bytes from stdin and prints their sum to stdout.
+core::posix::ChildProcess fork_summing_child(std::size_t size)
+{
+    return core::posix::fork([size]()
+    {
+        std::vector<char> buffer(size);
+        std::cin.read(buffer.data(), size);
+        std::cout << std::accumulate(buffer.begin(), buffer.end(), 0u,
+                                     [](unsigned int sum, char c) { return sum + static_cast<unsigned char>(c); })
+                  << std::endl;
+        return core::posix::exit::Status::success;
+    }, core::posix::StandardStream::stdin | core::posix::StandardStream::stdout);
+}
+
+std::vector<char> make_payload(std::size_t size)
+{
+    std::vector<char> result(size);
+    for (std::size_t i = 0; i < size; i++)
+        result[i] = static_cast<char>(i % 251);
+    return result;
+}
+
+unsigned int sum_of(const std::vector<char>& v)
+{
+    return std::accumulate(v.begin(), v.end(), 0u,
+                           [](unsigned int sum, char c) { return sum + static_cast<unsigned char>(c); });
+}
+}
+
+TEST(LinuxZeroCopy, vmsplicing_a_buffer_into_stdin_of_a_child_works)
+{
+    static const std::size_t size = 4 * 1024 * 1024;
+    auto payload = make_payload(size);
+
+    auto child = fork_summing_child(size);
+    EXPECT_EQ(size, core::posix::linux::vmsplice_to_stdin_or_throw(child, payload.data(), payload.size()));
+
+    unsigned int sum{0}; child.cout() >> sum;
+    EXPECT_EQ(sum_of(payload), sum);
+
+    child.wait_for(core::posix::wait::Flags::untraced);
+}
+
+TEST(LinuxZeroCopy, splicing_a_file_into_stdin_of_a_child_works)
+{
+    static const std::size_t size = 1024 * 1024;
+    static const off_t offset = 4096;
+    auto payload = make_payload(size + offset);
+
+    FILE* file = std::tmpfile();
+    ASSERT_NE(nullptr, file);
+    ASSERT_EQ(payload.size(), std::fwrite(payload.data(), 1, payload.size(), file));
+    std::fflush(file);
+
+    auto child = fork_summing_child(size);
+    EXPECT_EQ(size, core::posix::linux::splice_to_stdin_or_throw(child, ::fileno(file), offset, size));
+
+    unsigned int sum{0}; child.cout() >> sum;
+    EXPECT_EQ(sum_of(std::vector<char>(payload.begin() + offset, payload.end())), sum);
+
+    child.wait_for(core::posix::wait::Flags::untraced);
+    std::fclose(file);
+}
+
+TEST(LinuxZeroCopy, feeding_stdin_of_a_child_without_redirected_stdin_reports_error)
+{
+    auto child = core::posix::fork([]() { return core::posix::exit::Status::success; },
+                                   core::posix::StandardStream::empty);
+
+    std::error_code e;
+    char c{0};
+    EXPECT_EQ(0u, core::posix::linux::vmsplice_to_stdin(child, &c, sizeof(c), e));
+    EXPECT_TRUE(static_cast<bool>(e));
+
+    child.wait_for(core::posix::wait::Flags::untraced);
+}
+
+TEST(LinuxZeroCopy, a_sealed_memory_file_can_be_mapped_as_stdin_by_children)
+{
+    static const std::size_t size = 64 * 1024;
+    auto payload = make_payload(size);
+
+    auto file = core::posix::linux::SealedMemoryFile::create_or_throw("payload", payload.data(), payload.size());
+    EXPECT_EQ(size, file.size());
+
+    // The file must not be writable anymore.
+    char c{0};
+    EXPECT_EQ(-1, ::pwrite(file.native_handle(), &c, sizeof(c), 0));
+
+    auto redirect = file.redirect_to_stdin();
+
+    for (int i = 0; i < 2; i++)
+    {
+        auto child = core::posix::fork([redirect]()
+        {
+            redirect();
+
+            struct stat st;
+            if (::fstat(STDIN_FILENO, &st) == -1)
+                return core::posix::exit::Status::failure;
+
+            auto p = static_cast<const unsigned char*>(
+                        ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, STDIN_FILENO, 0));
+            if (p == MAP_FAILED)
+                return core::posix::exit::Status::failure;
+
+            std::cout << std::accumulate(p, p + st.st_size, 0u) << std::endl;
+            return core::posix::exit::Status::success;
+        }, core::posix::StandardStream::stdout);
+
+        unsigned int sum{0}; child.cout() >> sum;
+        EXPECT_EQ(sum_of(payload), sum);
+
+        auto result = child.wait_for(core::posix::wait::Flags::untraced);
+        EXPECT_EQ(core::posix::wait::Result::Status::exited, result.status);
+        EXPECT_EQ(core::posix::exit::Status::success, result.detail.if_exited.status);
+    }
+}
@@ -16,17 +16,27 @@
  * Authored by: Thomas Voß <thomas.voss@canonical.com>
  */
 
+#include <core/posix/bounded_capture.h>
 #include <core/posix/exec.h>
 #include <core/posix/fork.h>
 #include <core/posix/process.h>
+#include <core/posix/process_set.h>
 #include <core/posix/signal.h>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <future>
 #include <map>
+#include <set>
 #include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <signal.h>
 
 namespace
 {
@@ -230,6 +240,411 @@ TEST_F(ForkedSpinningProcess, signalling_a_forked_child_makes_wait_for_return_co
               result.detail.if_signaled.signal);
 }
 
+TEST_F(ForkedSpinningProcess, waiting_with_a_timeout_for_a_forked_child_returns_no_state_change_on_expiry)
+{
+    static const std::chrono::milliseconds timeout{100};
+
+    auto start = std::chrono::steady_clock::now();
+    auto result = child.wait_for(core::posix::wait::Flags::untraced, timeout);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    EXPECT_EQ(core::posix::wait::Result::Status::no_state_change,
+              result.status);
+    EXPECT_LE(timeout, elapsed);
+    EXPECT_GT(10 * timeout, elapsed);
+
+    result = child.wait_until(core::posix::wait::Flags::untraced, std::chrono::steady_clock::now());
+    EXPECT_EQ(core::posix::wait::Result::Status::no_state_change,
+              result.status);
+
+    EXPECT_NO_THROW(child.send_signal_or_throw(core::posix::Signal::sig_kill));
+
+    start = std::chrono::steady_clock::now();
+    result = child.wait_for(core::posix::wait::Flags::untraced, std::chrono::seconds{10});
+
+    EXPECT_GT(std::chrono::seconds{1}, std::chrono::steady_clock::now() - start);
+    EXPECT_EQ(core::posix::wait::Result::Status::signaled,
+              result.status);
+    EXPECT_EQ(core::posix::Signal::sig_kill,
+              result.detail.if_signaled.signal);
+}
+
+TEST_F(ForkedSpinningProcess, waiting_with_the_maximum_timeout_for_a_forked_child_waits_for_it)
+{
+    std::thread killer{[this]()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds{100});
+
+        std::error_code ec;
+        child.send_signal(core::posix::Signal::sig_kill, ec);
+    }};
+
+    auto result = child.wait_for(core::posix::wait::Flags::untraced, std::chrono::nanoseconds::max());
+    killer.join();
+
+    EXPECT_EQ(core::posix::wait::Result::Status::signaled,
+              result.status);
+    EXPECT_EQ(core::posix::Signal::sig_kill,
+              result.detail.if_signaled.signal);
+}
+
+TEST(ChildProcess, exit_futures_of_many_children_resolve_once_they_terminate)
+{
+    static const std::size_t child_count = 100;
+
+    std::vector<core::posix::ChildProcess> children;
+    std::vector<std::shared_future<core::posix::wait::Result>> futures;
+
+    for (std::size_t i = 0; i < child_count; i++)
+    {
+        children.push_back(core::posix::fork([i]()
+        {
+            return i % 2 == 0 ? core::posix::exit::Status::success : core::posix::exit::Status::failure;
+        }, core::posix::StandardStream::empty));
+
+        futures.push_back(children.back().exit_future());
+    }
+
+    for (std::size_t i = 0; i < child_count; i++)
+    {
+        ASSERT_EQ(std::future_status::ready, futures[i].wait_for(std::chrono::seconds{10}));
+
+        auto result = futures[i].get();
+        EXPECT_EQ(core::posix::wait::Result::Status::exited, result.status);
+        EXPECT_EQ(i % 2 == 0 ? core::posix::exit::Status::success : core::posix::exit::Status::failure,
+                  result.detail.if_exited.status);
+    }
+
+    // Repeated calls hand out the already resolved future.
+    EXPECT_EQ(std::future_status::ready, children.front().exit_future().wait_for(std::chrono::seconds{0}));
+}
+
+TEST(ChildProcess, waiting_for_any_and_all_of_a_set_of_children_reports_their_terminations)
+{
+    static const std::size_t child_count = 200;
+
+    auto wait_for_exit = []()
+    {
+        std::string line;
+        std::cin >> line;
+        return core::posix::exit::Status::failure;
+    };
+
+    std::vector<core::posix::ChildProcess> children;
+    for (std::size_t i = 0; i < child_count; i++)
+        children.push_back(core::posix::fork(wait_for_exit, core::posix::StandardStream::stdin));
+
+    auto changes = core::posix::wait_any(children, std::chrono::steady_clock::now() + std::chrono::milliseconds{50});
+    EXPECT_TRUE(changes.empty());
+
+    children[42].cin() << "exit" << std::endl;
+
+    changes = core::posix::wait_any(children);
+    ASSERT_EQ(1u, changes.size());
+    EXPECT_EQ(42u, changes.front().index);
+    EXPECT_EQ(core::posix::wait::Result::Status::exited, changes.front().result.status);
+    EXPECT_EQ(core::posix::exit::Status::failure, changes.front().result.detail.if_exited.status);
+
+    children.erase(children.begin() + 42);
+
+    for (auto& child : children)
+        child.send_signal_or_throw(core::posix::Signal::sig_kill);
+
+    changes = core::posix::wait_all(children, std::chrono::steady_clock::now() + std::chrono::seconds{10});
+    ASSERT_EQ(children.size(), changes.size());
+
+    std::vector<bool> seen(children.size(), false);
+    for (const auto& change : changes)
+    {
+        EXPECT_FALSE(seen[change.index]);
+        seen[change.index] = true;
+
+        EXPECT_EQ(core::posix::wait::Result::Status::signaled, change.result.status);
+        EXPECT_EQ(core::posix::Signal::sig_kill, change.result.detail.if_signaled.signal);
+    }
+}
+
+TEST(ChildProcess, shutting_down_a_set_of_children_escalates_to_sig_kill_after_the_grace_period)
+{
+    static const std::size_t child_count = 50;
+    static const std::chrono::milliseconds grace_period{200};
+
+    std::vector<core::posix::ChildProcess> children;
+    for (std::size_t i = 0; i < child_count; i++)
+    {
+        children.push_back(core::posix::fork([i]()
+        {
+            // Every other child refuses to terminate gracefully.
+            if (i % 2 == 1)
+                ::signal(SIGTERM, SIG_IGN);
+
+            std::cout << "ready" << std::endl;
+            while (true)
+                std::this_thread::sleep_for(std::chrono::seconds{1});
+
+            return core::posix::exit::Status::failure;
+        }, core::posix::StandardStream::stdout));
+
+        std::string line; children.back().cout() >> line;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto changes = core::posix::shutdown(children, grace_period);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    EXPECT_LE(grace_period, elapsed);
+    EXPECT_GT(5 * grace_period, elapsed);
+
+    ASSERT_EQ(child_count, changes.size());
+    for (const auto& change : changes)
+    {
+        EXPECT_EQ(core::posix::wait::Result::Status::signaled, change.result.status);
+        EXPECT_EQ(change.index % 2 == 1 ? core::posix::Signal::sig_kill : core::posix::Signal::sig_term,
+                  change.result.detail.if_signaled.signal);
+    }
+}
+
+TEST(ChildProcess, signalling_a_set_of_processes_reports_errors_per_process)
+{
+    static const std::size_t child_count = 64;
+
+    auto wait_for_signal = []()
+    {
+        while (true)
+            std::this_thread::sleep_for(std::chrono::seconds{1});
+
+        return core::posix::exit::Status::failure;
+    };
+
+    std::vector<core::posix::ChildProcess> children;
+    for (std::size_t i = 0; i < child_count; i++)
+        children.push_back(core::posix::fork(wait_for_signal, core::posix::StandardStream::empty));
+
+    // A process that has been reaped already cannot be signalled.
+    auto gone = core::posix::fork([]() { return core::posix::exit::Status::success; },
+                                  core::posix::StandardStream::empty);
+    gone.wait_for(core::posix::wait::Flags::untraced);
+
+    core::posix::ProcessSet set{children};
+    EXPECT_EQ(child_count, set.add(gone));
+    EXPECT_EQ(child_count + 1, set.size());
+
+    auto errors = set.signal_all(core::posix::Signal::sig_cont);
+    ASSERT_EQ(child_count + 1, errors.size());
+    for (std::size_t i = 0; i < child_count; i++)
+        EXPECT_FALSE(errors[i]);
+    EXPECT_EQ(ESRCH, errors.back().value());
+
+    errors = set.signal_all(core::posix::Signal::sig_kill, 4);
+    ASSERT_EQ(child_count + 1, errors.size());
+    for (std::size_t i = 0; i < child_count; i++)
+        EXPECT_FALSE(errors[i]);
+    EXPECT_EQ(ESRCH, errors.back().value());
+
+    auto changes = core::posix::wait_all(children, std::chrono::steady_clock::now() + std::chrono::seconds{10});
+    ASSERT_EQ(child_count, changes.size());
+    for (const auto& change : changes)
+    {
+        EXPECT_EQ(core::posix::wait::Result::Status::signaled, change.result.status);
+        EXPECT_EQ(core::posix::Signal::sig_kill, change.result.detail.if_signaled.signal);
+    }
+}
+
+TEST(Process, opening_an_existing_process_yields_a_handle_bound_to_its_identity)
+{
+    auto child = core::posix::fork([]()
+    {
+        while (true)
+            std::this_thread::sleep_for(std::chrono::seconds{1});
+
+        return core::posix::exit::Status::failure;
+    }, core::posix::StandardStream::empty);
+
+    auto process = core::posix::Process::open_or_throw(child.pid());
+    EXPECT_EQ(child.pid(), process.pid());
+    EXPECT_NE(-1, process.pidfd());
+    EXPECT_LT(0, process.start_time());
+    EXPECT_FALSE(process.has_terminated_or_throw());
+
+    EXPECT_NO_THROW(core::posix::Process::open_or_throw(child.pid(), process.start_time()));
+    EXPECT_THROW(core::posix::Process::open_or_throw(child.pid(), process.start_time() + 1), std::system_error);
+
+    process.send_signal_or_throw(core::posix::Signal::sig_kill);
+
+    // The pidfd becomes readable once the process has terminated.
+    ::pollfd fd{process.pidfd(), POLLIN, 0};
+    EXPECT_EQ(1, ::poll(&fd, 1, 10 * 1000));
+    EXPECT_TRUE(process.has_terminated_or_throw());
+
+    auto result = child.wait_for(core::posix::wait::Flags::untraced);
+    EXPECT_EQ(core::posix::wait::Result::Status::signaled, result.status);
+    EXPECT_EQ(core::posix::Signal::sig_kill, result.detail.if_signaled.signal);
+
+    // Once reaped, the handle never reaches a process that recycled the pid.
+    std::error_code e;
+    process.send_signal(core::posix::Signal::sig_kill, e);
+    EXPECT_EQ(ESRCH, e.value());
+}
+
+TEST(Process, queued_signals_sent_via_an_opened_handle_carry_their_payload)
+{
+    static const int payload = 42;
+
+    // The child inherits the blocked signal, and thus cannot miss it.
+    ::sigset_t set; ::sigemptyset(&set); ::sigaddset(&set, SIGUSR1);
+    ::sigset_t old; ::pthread_sigmask(SIG_BLOCK, &set, &old);
+
+    auto child = core::posix::fork([set]()
+    {
+        ::siginfo_t info;
+        if (::sigwaitinfo(&set, &info) != SIGUSR1)
+            return core::posix::exit::Status::failure;
+
+        return info.si_value.sival_int == payload && info.si_pid == ::getppid() ?
+                    core::posix::exit::Status::success :
+                    core::posix::exit::Status::failure;
+    }, core::posix::StandardStream::empty);
+
+    ::pthread_sigmask(SIG_SETMASK, &old, nullptr);
+
+    auto process = core::posix::Process::open_or_throw(child.pid());
+    process.send_signal_with_value_or_throw(core::posix::Signal::sig_usr1, payload);
+
+    auto result = child.wait_for(core::posix::wait::Flags::untraced);
+    EXPECT_EQ(core::posix::wait::Result::Status::exited, result.status);
+    EXPECT_EQ(core::posix::exit::Status::success, result.detail.if_exited.status);
+}
+
+TEST(Process, opening_processes_that_are_not_children_works)
+{
+    auto parent = core::posix::Process::open_or_throw(::getppid());
+    EXPECT_FALSE(parent.has_terminated_or_throw());
+
+    auto gone = core::posix::fork([]() { return core::posix::exit::Status::success; },
+                                  core::posix::StandardStream::empty);
+    gone.wait_for(core::posix::wait::Flags::untraced);
+
+    EXPECT_THROW(core::posix::Process::open_or_throw(gone.pid()), std::system_error);
+    EXPECT_THROW(core::posix::Process{::getpid()}.has_terminated_or_throw(), std::logic_error);
+}
+
+TEST(ChildProcess, a_pipeline_spawned_into_its_own_process_group_is_killed_and_reaped_as_a_unit)
+{
+    auto wait_for_signal = []()
+    {
+        while (true)
+            std::this_thread::sleep_for(std::chrono::seconds{1});
+
+        return core::posix::exit::Status::failure;
+    };
+
+    std::vector<core::posix::ChildProcess> pipeline;
+    pipeline.push_back(core::posix::fork(wait_for_signal,
+                                         core::posix::StandardStream::empty,
+                                         core::posix::Grouping::new_process_group()));
+
+    auto group = core::posix::ProcessGroup::led_by(pipeline.front());
+    EXPECT_EQ(pipeline.front().pid(), group.id());
+    EXPECT_NE(core::posix::this_process::instance().process_group_or_throw().id(), group.id());
+
+    pipeline.push_back(core::posix::fork(wait_for_signal,
+                                         core::posix::StandardStream::empty,
+                                         core::posix::Grouping::join(group)));
+    pipeline.push_back(core::posix::fork(wait_for_signal,
+                                         core::posix::StandardStream::empty,
+                                         core::posix::Grouping::join(group)));
+
+    std::set<pid_t> members;
+    for (auto& child : pipeline)
+    {
+        EXPECT_EQ(group.id(), child.process_group_or_throw().id());
+        members.insert(child.pid());
+    }
+
+    auto change = group.wait_for(core::posix::wait::Flags::no_hang);
+    EXPECT_EQ(0, change.pid);
+    EXPECT_EQ(core::posix::wait::Result::Status::no_state_change, change.result.status);
+
+    group.send_signal_or_throw(core::posix::Signal::sig_kill);
+
+    auto changes = group.wait_all();
+    ASSERT_EQ(pipeline.size(), changes.size());
+
+    std::set<pid_t> reaped;
+    for (const auto& change : changes)
+    {
+        reaped.insert(change.pid);
+        EXPECT_EQ(core::posix::wait::Result::Status::signaled, change.result.status);
+        EXPECT_EQ(core::posix::Signal::sig_kill, change.result.detail.if_signaled.signal);
+    }
+    EXPECT_EQ(members, reaped);
+
+    EXPECT_THROW(group.wait_for(core::posix::wait::Flags::untraced), std::system_error);
+}
+
+TEST(ChildProcess, a_child_spawned_into_a_new_session_leads_it)
+{
+    auto child = core::posix::fork([]()
+    {
+        return ::getsid(0) == ::getpid() && ::getpgid(0) == ::getpid() ?
+                    core::posix::exit::Status::success :
+                    core::posix::exit::Status::failure;
+    }, core::posix::StandardStream::empty, core::posix::Grouping::new_session());
+
+    auto result = child.wait_for(core::posix::wait::Flags::untraced);
+    EXPECT_EQ(core::posix::wait::Result::Status::exited, result.status);
+    EXPECT_EQ(core::posix::exit::Status::success, result.detail.if_exited.status);
+}
+
+TEST(ChildProcess, destroying_the_last_instance_of_a_child_process_does_not_leave_a_zombie)
+{
+    auto is_gone = [](pid_t pid)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{10};
+        while (::kill(pid, 0) == 0 && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+
+        return ::kill(pid, 0) == -1 && errno == ESRCH;
+    };
+
+    auto spin = []()
+    {
+        while (true)
+            std::this_thread::sleep_for(std::chrono::seconds{1});
+
+        return core::posix::exit::Status::failure;
+    };
+
+    EXPECT_EQ(core::posix::ChildProcess::DestructionPolicy::kill_and_reap,
+              core::posix::ChildProcess::default_destruction_policy());
+
+    pid_t pid = core::posix::fork(spin, core::posix::StandardStream::empty).pid();
+    EXPECT_TRUE(is_gone(pid));
+
+    // The child keeps running if asked to, and is reaped once it terminates.
+    {
+        auto child = core::posix::fork(spin, core::posix::StandardStream::empty);
+        child.set_destruction_policy(core::posix::ChildProcess::DestructionPolicy::reap);
+        pid = child.pid();
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds{50});
+    ASSERT_EQ(0, ::kill(pid, 0));
+    EXPECT_EQ(0, ::kill(pid, SIGKILL));
+    EXPECT_TRUE(is_gone(pid));
+
+    // The child is left alone entirely if asked to.
+    {
+        auto child = core::posix::fork(spin, core::posix::StandardStream::empty);
+        child.set_destruction_policy(core::posix::ChildProcess::DestructionPolicy::keep_running);
+        pid = child.pid();
+    }
+
+    EXPECT_EQ(0, ::kill(pid, SIGKILL));
+    int status{-1};
+    EXPECT_EQ(pid, ::waitpid(pid, &status, 0));
+}
+
 TEST(ChildProcess, stopping_a_forked_child_makes_wait_for_return_correct_result)
 {
     core::posix::ChildProcess child = core::posix::fork(
@@ -449,6 +864,149 @@ TEST_F(ForkedSpinningProcess, observing_child_processes_for_death_works_if_child
         worker.join();
 }
 
+TEST(ChildProcess, observing_child_processes_for_death_works_if_child_moved_to_another_process_group)
+{
+    using namespace ::testing;
+
+    auto child = core::posix::fork([]()
+    {
+        // We leave our parent's process group and wait for the signal to exit.
+        if (::setpgid(0, 0) == -1)
+            return core::posix::exit::Status::failure;
+
+        std::string line;
+        std::cin >> line;
+        return core::posix::exit::Status::success;
+    }, core::posix::StandardStream::stdin);
+
+    ChildDeathObserverEventCollector event_collector;
+
+    core::ScopedConnection sc
+    {
+        init.death_observer->child_died().connect([&event_collector](const core::posix::ChildProcess& cp)
+        {
+            event_collector.on_child_died(cp);
+        })
+    };
+
+    EXPECT_TRUE(init.death_observer->add(child));
+    EXPECT_CALL(event_collector, on_child_died(_))
+            .Times(1)
+            .WillOnce(
+                InvokeWithoutArgs(
+                    init.signal_trap.get(),
+                    &core::posix::SignalTrap::stop));
+
+    std::thread worker{[]() { init.signal_trap->run(); }};
+
+    child.cin() << "exit" << std::endl;
+
+    if (worker.joinable())
+        worker.join();
+
+    EXPECT_FALSE(init.death_observer->has(child));
+}
+
+TEST(ChildProcess, multiple_death_observers_each_report_the_death_of_their_own_children)
+{
+    auto observer = core::posix::ChildProcess::DeathObserver::create_with_signal_trap(init.signal_trap);
+
+    auto wait_for_exit = []()
+    {
+        std::string line;
+        std::cin >> line;
+        return core::posix::exit::Status::success;
+    };
+
+    auto first = core::posix::fork(wait_for_exit, core::posix::StandardStream::stdin);
+    auto second = core::posix::fork(wait_for_exit, core::posix::StandardStream::stdin);
+
+    std::atomic<pid_t> died_first{-1}, died_second{-1};
+    std::atomic<int> deaths{0};
+
+    core::ScopedConnection sc1
+    {
+        init.death_observer->child_died().connect([&](const core::posix::ChildProcess& cp)
+        {
+            died_first = cp.pid();
+            if (++deaths == 2)
+                init.signal_trap->stop();
+        })
+    };
+
+    core::ScopedConnection sc2
+    {
+        observer->child_died().connect([&](const core::posix::ChildProcess& cp)
+        {
+            died_second = cp.pid();
+            if (++deaths == 2)
+                init.signal_trap->stop();
+        })
+    };
+
+    EXPECT_TRUE(init.death_observer->add(first));
+    EXPECT_TRUE(observer->add(second));
+    EXPECT_FALSE(init.death_observer->has(second));
+    EXPECT_FALSE(observer->has(first));
+
+    std::thread worker{[]() { init.signal_trap->run(); }};
+
+    first.cin() << "exit" << std::endl;
+    second.cin() << "exit" << std::endl;
+
+    if (worker.joinable())
+        worker.join();
+
+    EXPECT_EQ(first.pid(), died_first.load());
+    EXPECT_EQ(second.pid(), died_second.load());
+    EXPECT_FALSE(init.death_observer->has(first));
+    EXPECT_FALSE(observer->has(second));
+}
+
+TEST(ChildProcess, observing_child_processes_for_death_reports_exit_details_and_resource_usage)
+{
+    auto child = core::posix::fork([]()
+    {
+        // Burn some CPU time before leaving.
+        auto start = std::chrono::steady_clock::now();
+        while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds{50});
+
+        return core::posix::exit::Status::failure;
+    }, core::posix::StandardStream::empty);
+
+    core::posix::ChildProcess::DeathObserver::Exit exit;
+
+    core::ScopedConnection sc
+    {
+        init.death_observer->child_exited().connect([&exit](const core::posix::ChildProcess::DeathObserver::Exit& e)
+        {
+            exit = e;
+            init.signal_trap->stop();
+        })
+    };
+
+    EXPECT_TRUE(init.death_observer->add(child));
+
+    std::thread worker{[]() { init.signal_trap->run(); }};
+
+    if (worker.joinable())
+        worker.join();
+
+    EXPECT_EQ(child.pid(), exit.pid);
+    EXPECT_EQ(core::posix::wait::Result::Status::exited, exit.result.status);
+    EXPECT_EQ(core::posix::exit::Status::failure, exit.result.detail.if_exited.status);
+    EXPECT_LT(std::chrono::microseconds{0}, exit.usage.user_time + exit.usage.system_time);
+    EXPECT_LT(0u, exit.usage.max_resident_set_size);
+
+    auto history = init.death_observer->exit_history();
+    ASSERT_FALSE(history.empty());
+    EXPECT_EQ(child.pid(), history.back().pid);
+
+    init.death_observer->set_exit_history_size(0);
+    EXPECT_TRUE(init.death_observer->exit_history().empty());
+    init.death_observer->set_exit_history_size(core::posix::ChildProcess::DeathObserver::default_exit_history_size);
+}
+
 TEST(ChildProcess, ensure_that_forked_children_are_cleaned_up)
 {
     static const unsigned int child_process_count = 100;
@@ -515,6 +1073,90 @@ TEST(StreamRedirect, redirecting_stdin_stdout_stderr_works)
     child.wait_for(core::posix::wait::Flags::untraced);
 }
 
+TEST(BoundedCapture, retains_head_and_tail_and_accounts_for_dropped_bytes)
+{
+    core::posix::BoundedCapture capture{{4, 4, core::posix::BoundedCapture::Policy::discard}};
+
+    const std::string data{"0123456789abcdef"};
+    EXPECT_EQ(data.size(), capture.write(data.data(), data.size()));
+
+    EXPECT_EQ("0123", capture.head());
+    EXPECT_EQ("cdef", capture.tail());
+    EXPECT_EQ(data.size(), capture.total());
+    EXPECT_EQ(8u, capture.dropped());
+    EXPECT_TRUE(capture.is_truncated());
+    EXPECT_FALSE(capture.is_full());
+}
+
+TEST(BoundedCapture, applying_backpressure_stops_consuming_until_reset)
+{
+    core::posix::BoundedCapture capture{{2, 2, core::posix::BoundedCapture::Policy::backpressure}};
+
+    const std::string data{"abcdef"};
+    EXPECT_EQ(4u, capture.write(data.data(), data.size()));
+    EXPECT_TRUE(capture.is_full());
+    EXPECT_EQ(0u, capture.dropped());
+    EXPECT_EQ("ab", capture.head());
+    EXPECT_EQ("cd", capture.tail());
+
+    capture.reset();
+    EXPECT_FALSE(capture.is_full());
+    EXPECT_EQ(2u, capture.write(data.data() + 4, 2));
+    EXPECT_EQ("ef", capture.head());
+}
+
+TEST(BoundedCapture, capturing_a_flooding_child_keeps_memory_bounded)
+{
+    static const std::size_t line_count = 100000;
+
+    core::posix::ChildProcess child = core::posix::fork(
+                []()
+                {
+                    std::cout << "begin" << std::endl;
+                    for (std::size_t i = 0; i < line_count; i++)
+                        std::cout << "0123456789\n";
+                    std::cout << "end" << std::flush;
+                    return core::posix::exit::Status::success;
+                },
+                core::posix::StandardStream::stdout);
+
+    core::posix::BoundedCapture capture{{5, 3, core::posix::BoundedCapture::Policy::discard}};
+    EXPECT_NO_THROW(capture.read_all_from_or_throw(
+                        child.native_handle(core::posix::StandardStream::stdout)));
+
+    EXPECT_EQ("begin", capture.head());
+    EXPECT_EQ("end", capture.tail());
+    EXPECT_EQ(6 + line_count * 11 + 3, capture.total());
+    EXPECT_EQ(capture.total() - 8, capture.dropped());
+
+    auto result = child.wait_for(core::posix::wait::Flags::untraced);
+    EXPECT_EQ(core::posix::wait::Result::Status::exited, result.status);
+}
+
+TEST(BoundedCapture, backpressure_leaves_unread_output_in_the_pipe)
+{
+    core::posix::ChildProcess child = core::posix::fork(
+                []()
+                {
+                    std::cout << "0123456789" << std::flush;
+                    return core::posix::exit::Status::success;
+                },
+                core::posix::StandardStream::stdout);
+
+    auto fd = child.native_handle(core::posix::StandardStream::stdout);
+
+    core::posix::BoundedCapture capture{{2, 2, core::posix::BoundedCapture::Policy::backpressure}};
+    capture.read_all_from_or_throw(fd);
+    EXPECT_TRUE(capture.is_full());
+    EXPECT_EQ("0123", capture.head() + capture.tail());
+
+    capture.reset();
+    capture.read_all_from_or_throw(fd);
+    EXPECT_EQ("4567", capture.head() + capture.tail());
+
+    child.wait_for(core::posix::wait::Flags::untraced);
+}
+
 TEST(Environment, iterating_the_environment_does_not_throw)
 {
     EXPECT_NO_THROW(core::posix::this_process::env::for_each(
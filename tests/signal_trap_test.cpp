@@ -0,0 +1,276 @@
+/*
+ * Copyright © 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Thomas Voß <thomas.voss@canonical.com>
+ */
+
+#include <core/posix/signal.h>
+#include <core/posix/this_process.h>
+
+#include <core/testing/fork_and_run.h>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <unistd.h>
+
+#include <sys/wait.h>
+
+namespace
+{
+std::shared_ptr<core::posix::SignalTrap> trap_usr1_and_usr2()
+{
+    return core::posix::trap_signals_for_process({core::posix::Signal::sig_usr1, core::posix::Signal::sig_usr2});
+}
+
+std::vector<int> one_to(int n)
+{
+    std::vector<int> result;
+    for (int i = 1; i <= n; i++)
+        result.push_back(i);
+    return result;
+}
+
+std::shared_ptr<core::posix::SignalTrap> trap_usr1_and_chld()
+{
+    return core::posix::trap_signals_for_process({core::posix::Signal::sig_usr1, core::posix::Signal::sig_chld});
+}
+
+std::size_t thread_count_of_this_process()
+{
+    std::ifstream status{"/proc/self/status"};
+
+    std::string line;
+    while (std::getline(status, line))
+        if (line.compare(0, 8, "Threads:") == 0)
+            return std::stoul(line.substr(8));
+
+    return 0;
+}
+}
+
+TESTP(SignalTrap, pending_signals_are_dispatched_from_an_external_event_loop,
+{
+    // Braced lists with multiple elements do not survive the macro.
+    auto trap = trap_usr1_and_usr2();
+
+    std::vector<core::posix::Signal> raised;
+    core::ScopedConnection sc
+    {
+        trap->signal_raised().connect([&raised](core::posix::Signal signal)
+        {
+            raised.push_back(signal);
+        })
+    };
+
+    EXPECT_EQ(0u, trap->dispatch_pending());
+
+    ::kill(::getpid(), SIGUSR1);
+    ::kill(::getpid(), SIGUSR2);
+
+    pollfd fd; fd.fd = trap->native_handle(); fd.events = POLLIN;
+    EXPECT_EQ(1, ::poll(&fd, 1, 1000));
+
+    EXPECT_EQ(2u, trap->dispatch_pending());
+    EXPECT_EQ(2u, raised.size());
+    EXPECT_EQ(0u, trap->dispatch_pending());
+})
+
+TESTP(SignalTrap, raised_signals_carry_sender_and_child_details,
+{
+    auto trap = trap_usr1_and_chld();
+
+    std::vector<core::posix::SignalInfo> raised;
+    core::ScopedConnection sc
+    {
+        trap->signal_raised_with_info().connect([&raised](const core::posix::SignalInfo& info)
+        {
+            raised.push_back(info);
+        })
+    };
+
+    ::kill(::getpid(), SIGUSR1);
+
+    pid_t child = ::fork();
+    if (child == 0)
+        ::_exit(42);
+
+    pollfd fd; fd.fd = trap->native_handle(); fd.events = POLLIN;
+    while (raised.size() < 2 && ::poll(&fd, 1, 1000) == 1)
+        trap->dispatch_pending();
+
+    EXPECT_EQ(2u, raised.size());
+
+    for (const auto& info : raised)
+    {
+        if (info.signal == core::posix::Signal::sig_usr1)
+        {
+            EXPECT_EQ(SI_USER, info.code);
+            EXPECT_EQ(::getpid(), info.sender_pid);
+            EXPECT_EQ(::getuid(), info.sender_uid);
+        } else
+        {
+            EXPECT_EQ(core::posix::Signal::sig_chld, info.signal);
+            EXPECT_EQ(CLD_EXITED, info.code);
+            EXPECT_EQ(child, info.sender_pid);
+            EXPECT_EQ(42, info.status);
+        }
+    }
+
+    int status{-1}; ::waitpid(child, &status, 0);
+})
+
+TESTP(SignalTrap, queued_realtime_signals_do_not_coalesce_and_carry_their_payload,
+{
+    auto doorbell = core::posix::realtime_signal(1);
+    EXPECT_TRUE(core::posix::is_realtime(doorbell));
+    EXPECT_FALSE(core::posix::is_realtime(core::posix::Signal::sig_usr1));
+    EXPECT_THROW(core::posix::realtime_signal(SIGRTMAX), std::out_of_range);
+
+    auto trap = core::posix::trap_signals_for_process({doorbell});
+
+    std::vector<int> values;
+    core::ScopedConnection sc
+    {
+        trap->signal_raised_with_info().connect([&values](const core::posix::SignalInfo& info)
+        {
+            values.push_back(info.value);
+        })
+    };
+
+    auto self = core::posix::this_process::instance();
+    for (int value = 1; value <= 3; value++)
+        self.send_signal_with_value_or_throw(doorbell, value);
+
+    EXPECT_EQ(3u, trap->dispatch_pending());
+    EXPECT_EQ(std::vector<int>({1, 2, 3}), values);
+})
+
+TESTP(SignalTrap, slow_subscribers_relayed_via_a_dispatcher_do_not_delay_other_signals,
+{
+    auto trap = trap_usr1_and_usr2();
+    // Created after the trap, such that the pool's threads do not receive the signals.
+    trap->dispatch_via(core::posix::Signal::sig_usr1, core::posix::thread_pool_dispatcher(2));
+
+    std::promise<void> usr2_handled;
+    std::promise<bool> usr1_handled;
+
+    // sig_usr1 is read first from the trap. Handling it inline would never
+    // see sig_usr2 being handled.
+    core::ScopedConnection sc
+    (
+        trap->signal_raised().connect([&](core::posix::Signal signal)
+        {
+            if (signal == core::posix::Signal::sig_usr2)
+                usr2_handled.set_value();
+            else
+                usr1_handled.set_value(
+                    usr2_handled.get_future().wait_for(std::chrono::seconds{5}) == std::future_status::ready);
+        })
+    );
+
+    ::kill(::getpid(), SIGUSR1);
+    ::kill(::getpid(), SIGUSR2);
+
+    EXPECT_EQ(2u, trap->dispatch_pending());
+    EXPECT_TRUE(usr1_handled.get_future().get());
+})
+
+TESTP(SignalTrap, signals_relayed_via_a_thread_pool_in_order_keep_their_order,
+{
+    static const int count = 100;
+
+    auto doorbell = core::posix::realtime_signal(2);
+    auto trap = core::posix::trap_signals_for_process({doorbell});
+    trap->dispatch_via(doorbell, core::posix::thread_pool_dispatcher(4), core::posix::SignalTrap::Ordering::in_order);
+
+    std::mutex guard;
+    std::condition_variable cv;
+    std::vector<int> values;
+
+    core::ScopedConnection sc
+    (
+        trap->signal_raised_with_info().connect([&](const core::posix::SignalInfo& info)
+        {
+            std::lock_guard<std::mutex> lg(guard);
+            values.push_back(info.value);
+            cv.notify_all();
+        })
+    );
+
+    auto self = core::posix::this_process::instance();
+    for (int value = 1; value <= count; value++)
+        self.send_signal_with_value_or_throw(doorbell, value);
+
+    std::size_t relayed{0};
+    while (relayed < count)
+        relayed += trap->dispatch_pending();
+
+    std::unique_lock<std::mutex> ul(guard);
+    EXPECT_TRUE(cv.wait_for(ul, std::chrono::seconds{5}, [&]() { return values.size() == count; }));
+    EXPECT_EQ(one_to(count), values);
+})
+
+TESTP(SignalTrap, dropping_a_route_from_a_handler_relayed_via_its_thread_pool_is_safe,
+{
+    auto doorbell = core::posix::realtime_signal(3);
+    auto trap = core::posix::trap_signals_for_process({doorbell});
+    auto self = core::posix::this_process::instance();
+    auto threads = thread_count_of_this_process();
+
+    for (int i = 0; i < 100; i++)
+    {
+        trap->dispatch_via(doorbell, core::posix::thread_pool_dispatcher(2), core::posix::SignalTrap::Ordering::in_order);
+
+        std::promise<void> relayed;
+        std::promise<void> dropped;
+        auto relayed_future = relayed.get_future();
+
+        // The route is the last owner of the pool once we are done relaying,
+        // and the task relaying the signal releases it on one of the pool's threads.
+        core::ScopedConnection sc
+        (
+            trap->signal_raised().connect([&](core::posix::Signal)
+            {
+                relayed_future.wait();
+                trap->dispatch_via(doorbell, core::posix::Dispatcher{});
+                dropped.set_value();
+            })
+        );
+
+        self.send_signal_or_throw(doorbell);
+        while (trap->dispatch_pending() == 0);
+
+        relayed.set_value();
+        dropped.get_future().wait();
+    }
+
+    // The threads of all pools wind down, instead of touching the pools' state after they are gone.
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{5};
+    while (thread_count_of_this_process() != threads && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+
+    EXPECT_EQ(threads, thread_count_of_this_process());
+})